@@ -8,9 +8,9 @@
 #include <cassert>
 #include <algorithm>
 
-ActiveConstraints::ActiveConstraints(const real_t *const AiZ, const real_t *const lb,
-									 const real_t *const ub, const real_t *const Li, const int_t nz):
-									 m_AiZ(AiZ), m_lb(lb), m_ub(ub), m_Li(Li),m_nz(nz)
+ActiveConstraints::ActiveConstraints(const real_t *const AiZ, const ConstraintRows *const rows, const ConstraintBounds *const bounds,
+									 const real_t *const Li, const int_t nz):
+									 m_AiZ(AiZ), m_Li(Li), m_rows(rows), m_bounds(bounds), m_nz(nz), m_nUpdates(0)
 {
 	m_Q			= new real_t [m_nz*m_nz]();
 	
@@ -19,29 +19,54 @@ ActiveConstraints::ActiveConstraints(const real_t *const AiZ, const real_t *cons
 	}
 	Rmat		= new Rmatrix (m_nz,active.getSizePtr());
 
+	// the active set can hold one extra constraint while it is full
+	m_W			= new real_t [(m_nz+1)*m_nz];
+	m_w			= new real_t [m_nz+1];
+
 	m_temp_nz	= new real_t [m_nz];
 	m_temp_nz2	= new real_t [m_nz];
+	m_temp_nznz	= new real_t [m_nz*m_nz];
+	m_temp_idx	= new int_t [m_nz+1];
 };
 
 ActiveConstraints::~ActiveConstraints(){
 	delete[] m_Q;
+	delete[] m_W;
+	delete[] m_w;
 	delete[] m_temp_nz;
 	delete[] m_temp_nz2;
+	delete[] m_temp_nznz;
+	delete[] m_temp_idx;
 	delete	 Rmat;
 }
 
 
+void ActiveConstraints::packConstraint(const int_t idx, const int_t pos){
+	real_t *const row = &m_W[pos*m_nz];
+	if (!m_AiZ){
+		// row evaluated on demand
+		m_rows->getRow(Utils::absolute(idx)-1,row);
+		if (idx<0){
+			Utils::ScalarVectorMult(row,-1,m_nz);
+		}
+	}else if(idx>0){	// upper bound, no sign inversion
+		Utils::VectorCopy(&m_AiZ[(idx-1)*m_nz],row,m_nz);
+	}else{		// lower bound, sign inversion
+		for (int_t k = 0; k<m_nz; ++k){
+			row[k] = -m_AiZ[(-idx-1)*m_nz+k];
+		}
+	}
+	m_w[pos] = m_bounds->getBound(idx);
+}
+
 void ActiveConstraints::addConstraint(const int_t viol_idx){
 	// Update Q,R,active set:
 	// Adds QT*Li*viol_lhs' at the end of matrix R (as a column)
+	const int_t nac = active.getSize();
+	packConstraint(viol_idx,nac);
 
 	// col = QT*Li*viol_lhs';
-	if(viol_idx>0)
-		Utils::MatVecMult(m_Li,&m_AiZ[(viol_idx-1)*m_nz],m_temp_nz,m_nz,m_nz);		// temp = Li*viol'
-	else{
-		Utils::MatVecMult(m_Li,&m_AiZ[(-viol_idx-1)*m_nz],m_temp_nz,m_nz,m_nz);		// temp = Li*viol'
-		Utils::ScalarVectorMult(m_temp_nz,-1,m_nz);
-	}
+	Utils::MatVecMult(m_Li,&m_W[nac*m_nz],m_temp_nz,m_nz,m_nz);						// temp = Li*viol'
 	Utils::MatTVecMult(m_Q,m_temp_nz,m_temp_nz2,m_nz,m_nz);							// temp2 = QT*temp
 	
 	// update R matrix
@@ -49,12 +74,101 @@ void ActiveConstraints::addConstraint(const int_t viol_idx){
 	
 	// update m_active
 	active.incrementSet(viol_idx);
+	++m_nUpdates;
 
 	// update Q: Qnew = Qold*GqT
 	Rmat->multiplyGqT(m_Q);
 
 }
 
+void ActiveConstraints::addConstraints(const int_t *const viol_idx, const int_t k){
+	// Update Q,R,active set with k columns at once
+	const int_t nac = active.getSize();
+	assert(nac+k<=m_nz && "Active set cannot hold the new constraints");
+
+	for (int_t t = 0; t<k; ++t){
+		packConstraint(viol_idx[t],nac+t);
+
+		// col = QT*Li*viol_lhs';
+		Utils::MatVecMult(m_Li,&m_W[(nac+t)*m_nz],m_temp_nz,m_nz,m_nz);			// temp = Li*viol'
+		Utils::MatTVecMult(m_Q,m_temp_nz,&m_temp_nznz[t*m_nz],m_nz,m_nz);		// col = QT*temp
+	}
+
+	// update R and Q matrix
+	Rmat->updateRBlock(m_temp_nznz,k,m_Q);
+
+	// update m_active
+	m_nUpdates += k;
+	for (int_t t = 0; t<k; ++t){
+		active.incrementSet(viol_idx[t]);
+	}
+}
+
+void ActiveConstraints::removeConstraints(const int_t *const idx, const int_t k){
+	// downdate Q, R, active set with k columns at once
+	if (k == 0){
+		return;
+	}
+	std::copy(idx,idx+k,m_temp_idx);
+	std::sort(m_temp_idx,m_temp_idx+k);
+	assert(m_temp_idx[0]>=0 && m_temp_idx[k-1]<active.getSize() && "Constraint to remove is out of range");
+
+	Rmat->downdateRBlock(m_temp_idx,k,m_Q);
+	m_nUpdates += k;
+
+	// compact packed rows and active set
+	int_t removed = 0;
+	const int_t nac = active.getSize();
+	for (int_t i = 0; i<nac; ++i){
+		if (removed<k && m_temp_idx[removed]==i){
+			active.decrementSet(i-removed);
+			++removed;
+		}else if (removed>0){
+			Utils::VectorCopy(&m_W[i*m_nz],&m_W[(i-removed)*m_nz],m_nz);
+			m_w[i-removed] = m_w[i];
+		}
+	}
+
+	if (active.getSize()==0){ // Initialize to identity
+		for (int i=0; i<m_nz; ++i){
+			for (int j=0; j<m_nz; ++j){
+				m_Q[i*m_nz+j] = 0.0;
+			}
+			m_Q[i*m_nz+i] = 1.0;				
+		}
+	}
+}
+
+void ActiveConstraints::computeDirection(const int_t idx, real_t *const d){
+	// d = QT*Li*a
+	if (!m_AiZ){
+		m_rows->getRow(Utils::absolute(idx)-1,m_temp_nz2);
+		Utils::MatVecMult(m_Li,m_temp_nz2,m_temp_nz,m_nz,m_nz);						// temp = Li*a'
+		if (idx<0){
+			Utils::ScalarVectorMult(m_temp_nz,-1,m_nz);
+		}
+	}else if(idx>0){
+		Utils::MatVecMult(m_Li,&m_AiZ[(idx-1)*m_nz],m_temp_nz,m_nz,m_nz);			// temp = Li*a'
+	}else{
+		Utils::MatVecMult(m_Li,&m_AiZ[(-idx-1)*m_nz],m_temp_nz,m_nz,m_nz);		// temp = -Li*a'
+		Utils::ScalarVectorMult(m_temp_nz,-1,m_nz);
+	}
+	Utils::MatTVecMult(m_Q,m_temp_nz,d,m_nz,m_nz);									// d = QT*temp
+}
+
+void ActiveConstraints::nullspaceStep(const real_t *const d, real_t *const step){
+	// temp = Q2*d2
+	const int_t nac = active.getSize();
+	for (int_t i = 0; i<m_nz; ++i){
+		m_temp_nz[i] = 0.0;
+		for (int_t k = nac; k<m_nz; ++k){
+			m_temp_nz[i] += m_Q[i*m_nz+k]*d[k];
+		}
+	}
+	// step = LiT*temp
+	Utils::MatTVecMult(m_Li,m_temp_nz,step,m_nz,m_nz);
+}
+
 void ActiveConstraints::resetActiveSet()
 {
 	// remove elements from active set
@@ -71,6 +185,27 @@ void ActiveConstraints::resetActiveSet()
 	}
 }
 
+void ActiveConstraints::setProblemMatrices(const real_t *const AiZ, const real_t *const Li)
+{
+	m_AiZ = AiZ;
+	m_Li = Li;
+	resetActiveSet();
+}
+
+void ActiveConstraints::setHessianFactor(const real_t *const Li){
+	m_Li = Li;
+
+	// add the active constraints again in the same order
+	const int_t nac = active.getSize();
+	for (int_t i = 0; i<nac; ++i){
+		m_temp_idx[i] = active.getIndex(i);
+	}
+	resetActiveSet();
+	for (int_t i = 0; i<nac; ++i){
+		addConstraint(m_temp_idx[i]);
+	}
+}
+
 void ActiveConstraints::removeConstraint(const int_t idx){
 	// downdate Q, R, active set
 
@@ -79,8 +214,11 @@ void ActiveConstraints::removeConstraint(const int_t idx){
 	assert(idx>=0 && "Constraint to remove is out of range");
 	
 	Rmat->downdateR(idx);
+	++m_nUpdates;
 
-	// update m_active
+	// update m_active and the packed rows behind idx
+	Utils::VectorCopy(&m_W[(idx+1)*m_nz],&m_W[idx*m_nz],(active.getSize()-idx-1)*m_nz);
+	Utils::VectorCopy(&m_w[idx+1],&m_w[idx],active.getSize()-idx-1);
 	active.decrementSet(idx);
 
 	// update Q
@@ -99,53 +237,40 @@ void ActiveConstraints::removeConstraint(const int_t idx){
 }
 
 void ActiveConstraints::multiplyW_vector(const real_t* const vec1, real_t* const vec2) const{
-	
-	for (int_t i = 0; i<active.getSize(); ++i){
-		vec2[i] = 0.0;
-		
-		if (active.getIndex(i)>0){ // upper bound, no sign inversion
-			for (int_t k = 0; k<m_nz; ++k){
-				vec2[i] += m_AiZ[(active.getIndex(i)-1)*m_nz+k]*vec1[k];
-			}
-		}else{				// lower bound, sign inversion
-			for (int_t k = 0; k<m_nz; ++k){
-				vec2[i] += -m_AiZ[(-active.getIndex(i)-1)*m_nz+k]*vec1[k];
-			}
-		
-		}
-	}
-
+	// vec2 = W*vec1
+	Utils::MatVecMult(m_W,vec1,vec2,active.getSize(),m_nz);
 }
 
 void ActiveConstraints::multiplyWT_vector(const real_t* const vec1, real_t* const vec2) const{
-	// vec2 must be a zero vector
-		for (int_t k = 0; k<m_nz; ++k){
-			vec2[k] = 0.0;
-		}
-	
-	for (int_t i = 0; i<active.getSize(); ++i){		
-		if (active.getIndex(i)>0){ // upper bound, no sign inversion
-			for (int_t k = 0; k<m_nz; ++k){
-				vec2[k] += m_AiZ[(active.getIndex(i)-1)*m_nz+k]*vec1[i];
-			}
-		}else{				// lower bound, sign inversion
-			for (int_t k = 0; k<m_nz; ++k){
-				vec2[k] += -m_AiZ[(-active.getIndex(i)-1)*m_nz+k]*vec1[i];
-			}
-		
-		}
-	}
-
+	// vec2 = WT*vec1
+	Utils::MatTVecMult(m_W,vec1,vec2,active.getSize(),m_nz);
 }
 
 void ActiveConstraints::add_w_vector(const real_t *vec1, real_t *const vec2) const{
+	// vec2 = vec1 + w
+	Utils::VectorAdd(vec1,m_w,vec2,active.getSize());
+}
+
+void ActiveConstraints::refreshBounds(){
 	for (int_t i = 0; i<active.getSize(); ++i){
-		vec2[i] = vec1[i];
-		
-		if (active.getIndex(i)>0){ // upper bound, no sign inversion
-			vec2[i] += m_ub[(active.getIndex(i)-1)];
-		}else{				// lower bound, sign inversion
-			vec2[i] += -m_lb[(-active.getIndex(i)-1)];
-		}
+		m_w[i] = m_bounds->getBound(active.getIndex(i));
+	}
+}
+
+void ActiveConstraints::getState(int_t *const indices, real_t *const Q, real_t *const R) const{
+	for (int_t i = 0; i<active.getSize(); ++i){
+		indices[i] = active.getIndex(i);
+	}
+	Utils::VectorCopy(m_Q, Q, m_nz*m_nz);
+	Rmat->getR(R);
+}
+
+void ActiveConstraints::setState(const int_t nac, const int_t *const indices, const real_t *const Q, const real_t *const R){
+	resetActiveSet();
+	for (int_t i = 0; i<nac; ++i){
+		packConstraint(indices[i], i);
+		active.incrementSet(indices[i]);
 	}
+	Utils::VectorCopy(Q, m_Q, m_nz*m_nz);
+	Rmat->setR(R);
 }
@@ -52,6 +52,30 @@ private:
 
 };
 
+/*!
+ * \brief Interface to evaluate the bounds of the constraints on demand.
+ */
+class ConstraintBounds{
+public:
+	/// destructor
+	virtual ~ConstraintBounds(){}
+
+	/// returns the bound of constraint idx: the upper bound for idx>0, the negative lower bound for idx<0
+	virtual real_t getBound(const int_t idx) const = 0;
+};
+
+/*!
+ * \brief Interface to evaluate the rows of the constraint matrix on demand.
+ */
+class ConstraintRows{
+public:
+	/// destructor
+	virtual ~ConstraintRows(){}
+
+	/// copy row i (starting at 0) of the constraint matrix to row
+	virtual void getRow(const int_t i, real_t *const row) const = 0;
+};
+
 /*! 
  * \brief This class performs matrix operations involving the active set. 
  * 
@@ -59,7 +83,9 @@ private:
  * W is the matrix containing the active constraints' coefficients. <br>
  * w is the vector containing the active bounds on these constraints. <br>
  * Matrix operations to be performed on the matrix W and the vector w are performed through this class. 
- * However, the matrix W is stored in the form of the QR decomposition of Li*W^T. The variable Rmat is used to
+ * W and w are kept as a contiguous copy of the active rows, with the sign of lower bound constraints
+ * already inverted, so that products with W are plain dense kernels. 
+ * The matrix W is also stored in the form of the QR decomposition of Li*W^T. The variable Rmat is used to
  * store the R matrix from the QR decomposition. 
  * 
  */
@@ -69,13 +95,14 @@ class ActiveConstraints{
 public:
 	/*! \brief constructor
 	 * 
-	 * \param AiZ contains the coefficients of inequality constraints
-	 * \param lb contains the lower bounds of inequality constraints
-	 * \param ub contains the containing upper bounds of inequality constraints
-	 * \param 
+	 * \param AiZ contains the coefficients of inequality constraints (NULL if they are evaluated by rows)
+	 * \param rows evaluates the rows of the constraint matrix if AiZ is NULL
+	 * \param bounds evaluates the bounds of the inequality constraints
+	 * \param Li is the inverse of the Cholesky decomposition of the Hessian
+	 * \param nz is the number of decision variables
 	 */
-	ActiveConstraints(const real_t *const AiZ, const real_t *const lb, 
-				const real_t *const ub, const real_t *const Li, const int_t nz); 
+	ActiveConstraints(const real_t *const AiZ, const ConstraintRows *const rows, const ConstraintBounds *const bounds, 
+				const real_t *const Li, const int_t nz); 
 	
 	/// destructor
 	~ActiveConstraints(); 
@@ -93,6 +120,21 @@ public:
 	void performRTRSub(real_t *const vec1){
 		Rmat->performRTRSubstitution(vec1);
 	};
+
+	/// vec1 = inv(R)*vec1;
+	void performRSub(real_t *const vec1){
+		Rmat->performRSubstitution(vec1);
+	};
+
+	/*! \brief compute the representation of a constraint in the basis of the QR decomposition
+	 *
+	 * d = Q^T*Li*a, where a is the row of constraint idx (sign inverted for lower bounds). The first
+	 * nac elements of d belong to the range of Li*W^T and the remaining elements to its null space.
+	 */
+	void computeDirection(const int_t idx, real_t *const d);
+
+	/// step = Li^T*Q2*d2, where Q2 are the null space columns of Q and d2 the last nz-nac elements of d
+	void nullspaceStep(const real_t *const d, real_t *const step);
 	
 	/// remove one constraint from Q and R
 	void removeConstraint(const int_t idx);
@@ -100,6 +142,20 @@ public:
 	/// add new constraint to Q and R
 	virtual void addConstraint(const int_t viol_idx);
 
+	/*! \brief add k new constraints to Q and R in one blocked update
+	 *
+	 * \param viol_idx contains the indices of the constraints (negative for lower bound)
+	 * \param k is the number of constraints, the active set size must not exceed nz afterwards
+	 */
+	void addConstraints(const int_t *const viol_idx, const int_t k);
+
+	/*! \brief remove k constraints from Q and R in one blocked update
+	 *
+	 * \param idx contains the positions of the constraints in the active set
+	 * \param k is the number of constraints
+	 */
+	void removeConstraints(const int_t *const idx, const int_t k);
+
 	/// returns the current active set size
 	const int_t& getActiveSetSize() const{
 		return active.getSize();
@@ -118,6 +174,39 @@ public:
 	/// reset active set: error handling
 	void resetActiveSet();
 
+	/// use the constraint matrix AiZ (NULL: evaluated by rows) and Li of another problem with the same dimensions and reset the active set
+	void setProblemMatrices(const real_t *const AiZ, const real_t *const Li);
+
+	/// use a new Li and compute the QR decomposition of the current active set again, the active set is kept
+	void setHessianFactor(const real_t *const Li);
+
+	/// returns the number of updates of Q and R since the last call to resetUpdateCount
+	const int_t& getUpdateCount() const{
+		return m_nUpdates;
+	};
+
+	/// reset the counter of updates of Q and R
+	void resetUpdateCount(){
+		m_nUpdates = 0;
+	};
+
+	/// evaluate the bounds of the active constraints again (call after the bounds are changed)
+	void refreshBounds();
+
+	/*! \brief copy the active set and its QR decomposition, e.g. for a snapshot of the solver
+	 *
+	 * \param indices receives the nac active constraints (negative for lower bound)
+	 * \param Q receives the nz*nz matrix Q
+	 * \param R receives the nac*(nac+1)/2 elements of R (packed column wise)
+	 */
+	void getState(int_t *const indices, real_t *const Q, real_t *const R) const;
+
+	/*! \brief set the active set and its QR decomposition copied by getState
+	 *
+	 * The active rows and their bounds are packed again from the constraint matrix and the current bounds.
+	 */
+	void setState(const int_t nac, const int_t *const indices, const real_t *const Q, const real_t *const R);
+
 
 protected:
 	
@@ -130,16 +219,28 @@ protected:
 	// const member variables 
 	
 	const real_t	*m_AiZ,					///< constraint matrix with all constraints
-					*m_lb,					///< lower and upper bounds
-					*m_ub,
 					*m_Li;					///< from the holesky decomposition of the Hessian
 
+	const ConstraintRows	*m_rows;		///< rows of the constraint matrix if m_AiZ is NULL
+
+	const ConstraintBounds	*m_bounds;		///< bounds of the constraints
+
 	const int_t		m_nz;
 
 	ConstraintSet	active;					///< active set
 
-	
+	real_t			*m_W,					///< active rows of AiZ (sign inverted for lower bounds), stored row wise
+					*m_w;					///< bounds of the active rows (-lb for lower bounds)
+
+	int_t			m_nUpdates;				///< number of constraints added to or removed from Q and R
+
 	real_t			*m_temp_nz,				// temporary variables
-					*m_temp_nz2;
+					*m_temp_nz2,
+					*m_temp_nznz;
+
+	int_t			*m_temp_idx;			// temporary storage of active set positions
+
+	/// copy the row of constraint idx and its bound with the sign of idx into position pos of W and w
+	void packConstraint(const int_t idx, const int_t pos);
 	
 };
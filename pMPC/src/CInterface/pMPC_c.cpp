@@ -0,0 +1,219 @@
+#include "pMPC_c.h"
+#include "../MPCSolver.h"
+#include "../QPSolver.h"
+#include "../ProblemData.h"
+#include "../Utils.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+static_assert(std::is_same<real_t, double>::value && std::is_same<int_t, int>::value,
+	"the C interface needs real_t = double and int_t = int");
+
+struct pmpc_solver{
+	pmpc_solver(std::shared_ptr<const ProblemData> data): mpc(data), Ax(data->n), Bu(data->n) {}
+
+	MPCSolver			mpc;
+	std::vector<real_t>	Ax,			///< workspace of pmpc_simulate
+						Bu;
+};
+
+struct pmpc_qp{
+	pmpc_qp(const real_t *Li, const real_t *g, const real_t *Aineq, const real_t *lbineq, const real_t *ubineq,
+		const int_t nz_i, const int_t nc_i, const real_t tolMin, const real_t tolMax, const int_t maxIter):
+		qp(Li, g, Aineq, lbineq, ubineq, nz_i, nc_i, tolMin, tolMax, maxIter), nz(nz_i), nc(nc_i) {}
+
+	QPSolver	qp;
+	int_t		nz,
+				nc;
+};
+
+int pmpc_api_version(void){
+	return PMPC_API_VERSION;
+}
+
+pmpc_solver* pmpc_create(const char *dir){
+	if (!dir || !Utils::FileExists((std::string(dir)+"/params").c_str())){
+		return 0;
+	}
+	std::shared_ptr<const ProblemData> data = ProblemData::load(dir);
+	if (!data->hasMPCData()){
+		return 0;
+	}
+	return new pmpc_solver(data);
+}
+
+pmpc_solver* pmpc_create_from_arrays(const pmpc_problem *p){
+	if (!p || p->n <= 0 || p->m <= 0 || p->s <= 0 || p->nz <= 0 || p->nc < 0 || p->np < p->m || p->nsteps <= 0 ||
+		!p->Li || !p->lbineq || !p->ubineq || !p->C || !p->Z || !p->F || !p->eta2u || !p->b_l || !p->b_u ||
+		!p->time_indices || (!p->AiZ != !p->AiC) || (!p->AiZ && (!p->C0 || !p->C1 || !p->tauk || !p->norms))){
+		return 0;
+	}
+	ProblemArrays a;
+	a.nz = p->nz;
+	a.nc = p->nc;
+	a.n = p->n;
+	a.m = p->m;
+	a.s = p->s;
+	a.np = p->np;
+	a.nsteps = p->nsteps;
+	a.ntau = p->ntau;
+	a.MAXITER = p->max_iter;
+	a.tolMin = p->tol_min;
+	a.tolMax = p->tol_max;
+	a.Li = p->Li;
+	a.g = p->g;
+	a.AiZ = p->AiZ;
+	a.AiC = p->AiC;
+	a.lbineq = p->lbineq;
+	a.ubineq = p->ubineq;
+	a.C = p->C;
+	a.Z = p->Z;
+	a.F = p->F;
+	a.eta2u = p->eta2u;
+	a.b_l = p->b_l;
+	a.b_u = p->b_u;
+	a.C0 = p->C0;
+	a.C1 = p->C1;
+	a.tauk = p->tauk;
+	a.norms = p->norms;
+	a.time_indices = p->time_indices;
+	return new pmpc_solver(std::make_shared<const ProblemData>(a));
+}
+
+pmpc_solver* pmpc_create_shared(const pmpc_solver *solver){
+	return solver?new pmpc_solver(solver->mpc.getProblemData()):0;
+}
+
+void pmpc_destroy(pmpc_solver *solver){
+	delete solver;
+}
+
+void pmpc_get_dimensions(const pmpc_solver *solver, int *n, int *m, int *nz, int *nc){
+	const ProblemData &data = *solver->mpc.getProblemData();
+	if (n){
+		*n = data.n;
+	}
+	if (m){
+		*m = data.m;
+	}
+	if (nz){
+		*nz = data.nz;
+	}
+	if (nc){
+		*nc = data.nc;
+	}
+}
+
+int pmpc_set_engine(pmpc_solver *solver, int dual){
+	if (!solver){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	solver->mpc.setEngine(dual?DUAL_ENGINE:PRIMAL_ENGINE);
+	return 0;
+}
+
+int pmpc_set_check(pmpc_solver *solver, int skip){
+	if (!solver){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	return solver->mpc.setCheckStrategy(skip?SKIP_CHECK:DENSE_CHECK)?0:-1;
+}
+
+int pmpc_set_threads(pmpc_solver *solver, int nthreads){
+	if (!solver || nthreads < 1){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	solver->mpc.setNumThreads(nthreads);
+	return 0;
+}
+
+int pmpc_solve(pmpc_solver *solver, const double *x0, double *u, int *iterations){
+	if (!solver || !x0 || !u){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	solver->mpc.solve(x0);
+	solver->mpc.getControlInputs(u);
+	if (iterations){
+		*iterations = solver->mpc.getIterNumber();
+	}
+	return solver->mpc.getExitFlag();
+}
+
+int pmpc_solve_batch(pmpc_solver *solver, int count, const double *x0, double *u, int *iterations, int *exit_flags){
+	if (!solver || count < 0 || (count > 0 && (!x0 || !u))){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	MPCSolver &mpc = solver->mpc;
+	const int_t n = mpc.getProblemData()->n, m = mpc.getNumberOfOutputs();
+	int_t failed = 0;
+	for (int_t i = 0; i < count; ++i){
+		mpc.solve(&x0[i*n]);
+		mpc.getControlInputs(&u[i*m]);
+		if (iterations){
+			iterations[i] = mpc.getIterNumber();
+		}
+		if (exit_flags){
+			exit_flags[i] = mpc.getExitFlag();
+		}
+		failed += (mpc.getExitFlag() != 0)?1:0;
+	}
+	return failed;
+}
+
+int pmpc_simulate(pmpc_solver *solver, int steps, const double *A, const double *B, const double *x0,
+	double *x, double *u, int *exit_flags){
+	if (!solver || steps < 0 || !A || !B || !x0 || !x || !u){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	MPCSolver &mpc = solver->mpc;
+	const int_t n = mpc.getProblemData()->n, m = mpc.getNumberOfOutputs();
+	real_t *Ax = solver->Ax.data(), *Bu = solver->Bu.data();
+	int_t failed = 0;
+	Utils::VectorCopy(x0, x, n);
+	for (int_t k = 0; k < steps; ++k){
+		mpc.solve(&x[k*n]);
+		mpc.getControlInputs(&u[k*m]);
+		if (exit_flags){
+			exit_flags[k] = mpc.getExitFlag();
+		}
+		failed += (mpc.getExitFlag() != 0)?1:0;
+
+		Utils::MatrixMult(A, &x[k*n], Ax, n, n, 1);
+		Utils::MatrixMult(B, &u[k*m], Bu, n, m, 1);
+		Utils::VectorAdd(Ax, Bu, &x[(k+1)*n], n);
+	}
+	return failed;
+}
+
+pmpc_qp* pmpc_qp_create(const double *Li, const double *g, const double *Aineq, const double *lbineq,
+	const double *ubineq, int nz, int nc, double tol_min, double tol_max, int max_iter){
+	if (!Li || !g || !Aineq || !lbineq || !ubineq || nz <= 0 || nc < 0){
+		return 0;
+	}
+	return new pmpc_qp(Li, g, Aineq, lbineq, ubineq, nz, nc, tol_min, tol_max, max_iter);
+}
+
+void pmpc_qp_destroy(pmpc_qp *qp){
+	delete qp;
+}
+
+int pmpc_qp_solve(pmpc_qp *qp, const double *g, const double *lbineq, const double *ubineq, double *z, int *iterations){
+	if (!qp || !z || (!lbineq != !ubineq)){
+		return PMPC_INVALID_ARGUMENT;
+	}
+	if (g){
+		qp->qp.setLinearTerm(g);
+	}
+	if (lbineq){
+		qp->qp.setBounds(lbineq, ubineq);
+	}
+	qp->qp.solve();
+	qp->qp.getSolutionCopy(z);
+	if (iterations){
+		*iterations = qp->qp.getIterNumber();
+	}
+	return qp->qp.getExitFlag();
+}
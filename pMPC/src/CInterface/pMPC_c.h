@@ -0,0 +1,115 @@
+#ifndef PMPC_C_H
+#define PMPC_C_H
+/*
+ * C interface of parameterized MPC, for other languages (Python ctypes, Julia ccall, Rust FFI, ...).
+ *
+ * The solvers are opaque handles. All matrices are double arrays stored row wise and all dimensions
+ * are int, as real_t and int_t of DefineSettings.h. The calls read and write arrays owned by the caller
+ * and do not keep pointers to them, so pmpc_solve_batch and pmpc_simulate run many solves in one call
+ * without copies. A handle must not be used by several threads at the same time; handles created with
+ * pmpc_create_shared share the problem data and can be used by one thread each.
+ *
+ * The functions return PMPC_INVALID_ARGUMENT (or NULL) for invalid arguments. Exit flags are those of
+ * QPSolver::getExitFlag, 0 for solved and -1 to -4 for the failures, so PMPC_INVALID_ARGUMENT cannot be
+ * mistaken for an exit flag.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(PMPC_SHARED)
+	#ifdef PMPC_BUILD
+		#define PMPC_API __declspec(dllexport)
+	#else
+		#define PMPC_API __declspec(dllimport)
+	#endif
+#else
+	#define PMPC_API
+#endif
+
+/* version of the interface, changed when a function or structure changes */
+#define PMPC_API_VERSION 2
+
+/* returned for invalid arguments (outside the range of the exit flags) */
+#define PMPC_INVALID_ARGUMENT (-100)
+
+/* MPC solver (MPCSolver) */
+typedef struct pmpc_solver pmpc_solver;
+
+/* QP solver (QPSolver) */
+typedef struct pmpc_qp pmpc_qp;
+
+/* matrices of an MPC problem in the layout of a problem directory of pMPC_build (see ProblemArrays) */
+typedef struct pmpc_problem{
+	int		nz, nc, n, m, s, np,
+			nsteps,			/* time steps of time_indices */
+			ntau,			/* time steps of tauk and norms */
+			max_iter;
+	double	tol_min, tol_max;
+	const double	*Li, *g, *AiZ, *AiC, *lbineq, *ubineq, *C, *Z, *F, *eta2u, *b_l, *b_u,
+					*C0, *C1, *tauk, *norms;	/* g, AiZ and AiC, or C0, C1, tauk and norms can be NULL */
+	const int		*time_indices;
+} pmpc_problem;
+
+/* returns PMPC_API_VERSION of the library */
+PMPC_API int pmpc_api_version(void);
+
+/* create a solver of the problem in a directory (bundle of pMPC_build or generateSolver.m), NULL if it
+ * cannot be read. Solvers of the same directory share the problem data. */
+PMPC_API pmpc_solver* pmpc_create(const char *dir);
+
+/* create a solver of a problem in memory, the arrays are copied. NULL if the dimensions are invalid. */
+PMPC_API pmpc_solver* pmpc_create_from_arrays(const pmpc_problem *problem);
+
+/* create another solver of the problem of solver, the problem data is shared */
+PMPC_API pmpc_solver* pmpc_create_shared(const pmpc_solver *solver);
+
+PMPC_API void pmpc_destroy(pmpc_solver *solver);
+
+/* get the number of states, inputs, decision variables and constraints (pointers can be NULL) */
+PMPC_API void pmpc_get_dimensions(const pmpc_solver *solver, int *n, int *m, int *nz, int *nc);
+
+/* select the engine: 0 primal, 1 dual active set method */
+PMPC_API int pmpc_set_engine(pmpc_solver *solver, int dual);
+
+/* select the constraint check: 0 dense, 1 skip constraints method. -1 if its matrices are not available. */
+PMPC_API int pmpc_set_check(pmpc_solver *solver, int skip);
+
+/* set the number of threads of the constraint check */
+PMPC_API int pmpc_set_threads(pmpc_solver *solver, int nthreads);
+
+/* solve for the state x0 (n values), writes u (m values) and the iterations (can be NULL).
+ * Returns the exit flag, or PMPC_INVALID_ARGUMENT. */
+PMPC_API int pmpc_solve(pmpc_solver *solver, const double *x0, double *u, int *iterations);
+
+/* solve for count states x0 (count x n) in order, each solve starts from the active set of the previous
+ * one. Writes u (count x m), the iterations and exit flags (count values each, can be NULL).
+ * Returns the number of solves with a nonzero exit flag. */
+PMPC_API int pmpc_solve_batch(pmpc_solver *solver, int count, const double *x0, double *u,
+	int *iterations, int *exit_flags);
+
+/* closed loop simulation of x(k+1) = A*x(k) + B*u(k) for steps time steps from x0. A is n x n, B is n x m.
+ * Writes the states x (steps+1 x n, x0 first), the inputs u (steps x m) and the exit flags (steps values,
+ * can be NULL). Returns the number of solves with a nonzero exit flag. */
+PMPC_API int pmpc_simulate(pmpc_solver *solver, int steps, const double *A, const double *B, const double *x0,
+	double *x, double *u, int *exit_flags);
+
+/* create a solver of the QP min 0.5*z'*inv(Li'*Li)*z + g'*z s.t. lbineq <= Aineq*z <= ubineq (see QPSolver),
+ * the arrays are copied */
+PMPC_API pmpc_qp* pmpc_qp_create(const double *Li, const double *g, const double *Aineq, const double *lbineq,
+	const double *ubineq, int nz, int nc, double tol_min, double tol_max, int max_iter);
+
+PMPC_API void pmpc_qp_destroy(pmpc_qp *qp);
+
+/* solve the QP with new g and bounds (NULL keeps the current values, lbineq and ubineq are given
+ * together), starting from the last active set. Writes z (nz values) and the iterations (can be NULL).
+ * Returns the exit flag, or PMPC_INVALID_ARGUMENT. */
+PMPC_API int pmpc_qp_solve(pmpc_qp *qp, const double *g, const double *lbineq, const double *ubineq,
+	double *z, int *iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
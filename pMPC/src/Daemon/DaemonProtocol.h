@@ -0,0 +1,83 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../DefineSettings.h"
+
+/*
+ * Binary protocol of pMPC_daemon over a Unix domain socket. Values are in the native format of
+ * real_t and int_t, client and daemon run on the same host.
+ *
+ * request:		int_t {DAEMON_MAGIC, type, handle, count}, then count states x0 (count x n real_t)
+ * response:	int_t {DAEMON_MAGIC, status, count, 0}, then for REQUEST_SOLVE the control inputs
+ *				(count x m real_t), the iterations and the exit flags (count int_t each),
+ *				for REQUEST_INFO the header is {DAEMON_MAGIC, status, n, m}
+ *
+ * The states of one request are solved in order by the solver of the connection for the problem
+ * handle, so each connection keeps warm starts as an embedded MPCSolver does.
+ */
+
+/// "pMPD" at the start of each message
+const int_t DAEMON_MAGIC = 0x44504d70;
+
+/// number of int_t in the header of a message
+const int_t DAEMON_HEADER = 4;
+
+/// largest number of states of one request
+const int_t DAEMON_MAX_COUNT = 1<<16;
+
+/// requests to the daemon
+enum DaemonRequest{
+	REQUEST_INFO = 1,			///< dimensions n and m of a problem
+	REQUEST_SOLVE = 2			///< solve count states
+};
+
+/// status of a response
+enum DaemonStatus{
+	STATUS_OK = 0,
+	STATUS_NO_PROBLEM = -1,		///< unknown problem handle
+	STATUS_INVALID = -2			///< unknown request or too many states
+};
+
+#ifdef MSG_NOSIGNAL
+	#define DAEMON_SEND_FLAGS MSG_NOSIGNAL
+#else
+	#define DAEMON_SEND_FLAGS 0
+#endif
+
+/// read size bytes from a socket, false if it is closed
+inline bool daemonRead(const int fd, void *const buf, const size_t size){
+	char *pos = (char*)buf;
+	size_t left = size;
+	while (left > 0){
+		const ssize_t nread = recv(fd, pos, left, 0);
+		if (nread < 0 && errno == EINTR){
+			continue;
+		}
+		if (nread <= 0){
+			return false;
+		}
+		pos += nread;
+		left -= nread;
+	}
+	return true;
+}
+
+/// write size bytes to a socket, false if it is closed
+inline bool daemonWrite(const int fd, const void *const buf, const size_t size){
+	const char *pos = (const char*)buf;
+	size_t left = size;
+	while (left > 0){
+		const ssize_t nwritten = send(fd, pos, left, DAEMON_SEND_FLAGS);
+		if (nwritten < 0 && errno == EINTR){
+			continue;
+		}
+		if (nwritten <= 0){
+			return false;
+		}
+		pos += nwritten;
+		left -= nwritten;
+	}
+	return true;
+}
@@ -0,0 +1,115 @@
+#include "SolverClient.h"
+#include "DaemonProtocol.h"
+
+#include <cstring>
+#include <sys/un.h>
+
+SolverClient::SolverClient(): fd(-1)
+{
+}
+
+SolverClient::~SolverClient(){
+	close();
+}
+
+bool SolverClient::connect(const std::string &path){
+	close();
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)){
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0){
+		return false;
+	}
+	if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0){
+		close();
+		return false;
+	}
+	return true;
+}
+
+void SolverClient::close(){
+	if (fd >= 0){
+		::close(fd);
+		fd = -1;
+	}
+	dims.clear();
+}
+
+bool SolverClient::getDimensions(const int_t handle, int_t &n, int_t &m){
+	return dimensions(handle, n, m);
+}
+
+bool SolverClient::dimensions(const int_t handle, int_t &n, int_t &m){
+	if (fd < 0 || handle < 0){
+		return false;
+	}
+	if ((size_t)handle < dims.size()/2 && dims[2*handle] > 0){
+		n = dims[2*handle];
+		m = dims[2*handle+1];
+		return true;
+	}
+
+	const int_t request[DAEMON_HEADER] = {DAEMON_MAGIC, REQUEST_INFO, handle, 0};
+	int_t reply[DAEMON_HEADER];
+	if (!daemonWrite(fd, request, sizeof(request)) || !daemonRead(fd, reply, sizeof(reply))){
+		close();
+		return false;
+	}
+	if (reply[0] != DAEMON_MAGIC || reply[1] != STATUS_OK){
+		return false;
+	}
+	n = reply[2];
+	m = reply[3];
+	if ((size_t)handle >= dims.size()/2){
+		dims.resize(2*(handle+1), 0);
+	}
+	dims[2*handle] = n;
+	dims[2*handle+1] = m;
+	return true;
+}
+
+bool SolverClient::solve(const int_t handle, const real_t *const x0, real_t *const u, int_t *const iterations,
+	int_t *const exitFlags, const int_t count){
+	int_t n, m;
+	if (count < 1 || count > DAEMON_MAX_COUNT || !dimensions(handle, n, m)){
+		return false;
+	}
+
+	// header and states in one write
+	const int_t request[DAEMON_HEADER] = {DAEMON_MAGIC, REQUEST_SOLVE, handle, count};
+	const size_t nx = count*n*sizeof(real_t);
+	buffer.resize(sizeof(request)+nx);
+	memcpy(&buffer[0], request, sizeof(request));
+	memcpy(&buffer[sizeof(request)], x0, nx);
+	if (!daemonWrite(fd, buffer.data(), buffer.size())){
+		close();
+		return false;
+	}
+
+	int_t reply[DAEMON_HEADER];
+	if (!daemonRead(fd, reply, sizeof(reply)) || reply[0] != DAEMON_MAGIC || reply[1] != STATUS_OK
+		|| reply[2] != count){
+		close();
+		return false;
+	}
+	const size_t nu = count*m*sizeof(real_t), ni = count*sizeof(int_t);
+	buffer.resize(nu+2*ni);
+	if (!daemonRead(fd, buffer.data(), buffer.size())){
+		close();
+		return false;
+	}
+	memcpy(u, &buffer[0], nu);
+	if (iterations){
+		memcpy(iterations, &buffer[nu], ni);
+	}
+	if (exitFlags){
+		memcpy(exitFlags, &buffer[nu+ni], ni);
+	}
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "../DefineSettings.h"
+
+/*! \class SolverClient
+ * \brief Connection of a controller to pMPC_daemon (see SolverServer and DaemonProtocol.h).
+ *
+ * The daemon keeps a solver for each problem used by the connection, so consecutive solves of a
+ * connection start warm as with an embedded MPCSolver. A client must not be used by several threads
+ * at the same time.
+ */
+class SolverClient{
+public:
+	/// constructor: not connected
+	SolverClient();
+
+	/// destructor: closes the connection
+	~SolverClient();
+
+	/// connect to the daemon at the socket path, false if it is not running
+	bool	connect(const std::string &path);
+
+	/// close the connection
+	void	close();
+
+	/// get the number of states and inputs of a problem, false if the handle is unknown
+	bool	getDimensions(const int_t handle, int_t &n, int_t &m);
+
+	/*!
+	 * \brief solve count states of a problem in order
+	 *
+	 * \param x0 contains the states (count x n)
+	 * \param u returns the control inputs (count x m)
+	 * \param iterations, exitFlags return count values each (can be NULL)
+	 * \return false if the connection failed or the handle is unknown
+	 */
+	bool	solve(const int_t handle, const real_t *const x0, real_t *const u, int_t *const iterations = 0,
+		int_t *const exitFlags = 0, const int_t count = 1);
+
+private:
+	/// dimensions of a handle from the cache or the daemon
+	bool	dimensions(const int_t handle, int_t &n, int_t &m);
+
+	int		fd;						///< socket (-1 if not connected)
+
+	std::vector<int_t>	dims;		///< n and m of the handles, 0 if not known yet
+
+	std::vector<char>	buffer;		///< message buffer
+};
@@ -0,0 +1,281 @@
+#include "SolverServer.h"
+#include "DaemonProtocol.h"
+#include "../MPCSolver.h"
+#include "../Utils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/un.h>
+
+namespace {
+	/// largest number of requests solved in one batch
+	const size_t MAX_BATCH = 64;
+}
+
+struct SolverServer::Connection{
+	Connection(const int fd_i, const size_t nproblems): fd(fd_i), solvers(nproblems, (MPCSolver*)0),
+		handle(0), count(0), done(false), finished(false) {}
+
+	~Connection(){
+		for (size_t i = 0; i < solvers.size(); ++i){
+			delete solvers[i];
+		}
+	}
+
+	int		fd;							///< socket (-1 when closed)
+
+	std::thread	thread;					///< thread of serve
+
+	std::vector<MPCSolver*>	solvers;	///< solver of each problem handle (NULL if not used yet)
+
+	// request in progress
+	int_t	handle,
+			count;
+
+	std::vector<real_t>	x0,				///< states of the request
+						u;				///< control inputs
+	std::vector<int_t>	iterations,
+						exitFlags;
+
+	bool	done;						///< set by the worker when the request is solved
+
+	std::mutex				mutex;		///< protects done
+	std::condition_variable	solved;		///< signals done
+
+	std::atomic<bool>	finished;		///< serve returned, the thread can be joined
+};
+
+SolverServer::SolverServer(const int_t nworkers_i): nworkers(nworkers_i>1?nworkers_i:1), listenFd(-1),
+	stopping(false), nstates(0), nrequests(0), nbatches(0)
+{
+}
+
+SolverServer::~SolverServer(){
+	stop();
+}
+
+int_t SolverServer::addProblem(const std::string &dir){
+	if (!Utils::FileExists((dir+"/params").c_str())){
+		printf("unable to read %s/params.txt\n", dir.c_str());
+		return -1;
+	}
+	std::shared_ptr<const ProblemData> data = ProblemData::load(dir);
+	if (!data->hasMPCData()){
+		printf("%s is not an MPC problem\n", dir.c_str());
+		return -1;
+	}
+	problems.push_back(data);
+	return (int_t)problems.size()-1;
+}
+
+bool SolverServer::start(const std::string &path_i){
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path_i.size() >= sizeof(addr.sun_path)){
+		printf("the socket path %s is too long\n", path_i.c_str());
+		return false;
+	}
+	strcpy(addr.sun_path, path_i.c_str());
+
+	// a socket file left by a daemon which did not stop is replaced
+	unlink(path_i.c_str());
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 64) != 0){
+		printf("unable to listen on %s\n", path_i.c_str());
+		if (listenFd >= 0){
+			close(listenFd);
+			listenFd = -1;
+		}
+		return false;
+	}
+	path = path_i;
+	stopping = false;
+	for (int_t i = 0; i < nworkers; ++i){
+		workers.push_back(std::thread(&SolverServer::work, this));
+	}
+	acceptThread = std::thread(&SolverServer::acceptLoop, this);
+	return true;
+}
+
+void SolverServer::stop(){
+	if (listenFd < 0){
+		return;
+	}
+
+	// no new connections
+	shutdown(listenFd, SHUT_RDWR);
+	acceptThread.join();
+	close(listenFd);
+	listenFd = -1;
+	unlink(path.c_str());
+
+	// the connection threads return after their current request
+	{
+		std::lock_guard<std::mutex> lock(connMutex);
+		for (size_t i = 0; i < connections.size(); ++i){
+			if (connections[i]->fd >= 0){
+				shutdown(connections[i]->fd, SHUT_RDWR);
+			}
+		}
+	}
+	for (size_t i = 0; i < connections.size(); ++i){
+		connections[i]->thread.join();
+		delete connections[i];
+	}
+	connections.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queued.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i){
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void SolverServer::acceptLoop(){
+	while (true){
+		const int fd = accept(listenFd, 0, 0);
+		if (fd < 0){
+			if (errno == EINTR || errno == ECONNABORTED){
+				continue;
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(connMutex);
+
+		// free the connections which were closed by their clients
+		for (size_t i = 0; i < connections.size();){
+			if (connections[i]->finished){
+				connections[i]->thread.join();
+				delete connections[i];
+				connections[i] = connections.back();
+				connections.pop_back();
+			}else{
+				++i;
+			}
+		}
+
+		Connection *conn = new Connection(fd, problems.size());
+		connections.push_back(conn);
+		conn->thread = std::thread(&SolverServer::serve, this, conn);
+	}
+}
+
+void SolverServer::serve(Connection *conn){
+	std::vector<char> response;
+	int_t header[DAEMON_HEADER];
+	while (daemonRead(conn->fd, header, sizeof(header)) && header[0] == DAEMON_MAGIC){
+		const int_t type = header[1], handle = header[2], count = header[3];
+		const bool known = (handle >= 0 && handle < (int_t)problems.size());
+		const ProblemData *data = known?problems[handle].get():0;
+
+		if (type == REQUEST_INFO){
+			const int_t info[DAEMON_HEADER] = {DAEMON_MAGIC, known?STATUS_OK:STATUS_NO_PROBLEM,
+				known?data->n:0, known?data->m:0};
+			if (!daemonWrite(conn->fd, info, sizeof(info))){
+				break;
+			}
+			continue;
+		}
+		if (type != REQUEST_SOLVE || !known || count < 0 || count > DAEMON_MAX_COUNT){
+			// the states cannot be skipped without the dimensions, the connection is closed
+			const int_t reply[DAEMON_HEADER] = {DAEMON_MAGIC, known?STATUS_INVALID:STATUS_NO_PROBLEM, 0, 0};
+			daemonWrite(conn->fd, reply, sizeof(reply));
+			break;
+		}
+
+		const int_t n = data->n, m = data->m;
+		conn->x0.resize(count*n);
+		if (!daemonRead(conn->fd, conn->x0.data(), count*n*sizeof(real_t))){
+			break;
+		}
+		if (!conn->solvers[handle]){
+			conn->solvers[handle] = new MPCSolver(problems[handle]);
+		}
+		conn->handle = handle;
+		conn->count = count;
+		conn->u.resize(count*m);
+		conn->iterations.resize(count);
+		conn->exitFlags.resize(count);
+		conn->done = false;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			queue.push_back(conn);
+		}
+		queued.notify_one();
+		{
+			std::unique_lock<std::mutex> lock(conn->mutex);
+			conn->solved.wait(lock, [conn]{return conn->done;});
+		}
+
+		// one write for the whole response
+		const int_t reply[DAEMON_HEADER] = {DAEMON_MAGIC, STATUS_OK, count, 0};
+		const size_t nu = count*m*sizeof(real_t), ni = count*sizeof(int_t);
+		response.resize(sizeof(reply)+nu+2*ni);
+		memcpy(&response[0], reply, sizeof(reply));
+		memcpy(&response[sizeof(reply)], conn->u.data(), nu);
+		memcpy(&response[sizeof(reply)+nu], conn->iterations.data(), ni);
+		memcpy(&response[sizeof(reply)+nu+ni], conn->exitFlags.data(), ni);
+		if (!daemonWrite(conn->fd, response.data(), response.size())){
+			break;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(connMutex);
+	close(conn->fd);
+	conn->fd = -1;
+	conn->finished = true;
+}
+
+void SolverServer::work(){
+	std::vector<Connection*> batch;
+	while (true){
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queued.wait(lock, [this]{return stopping || !queue.empty();});
+			if (queue.empty()){
+				return;
+			}
+
+			// the oldest request and the other queued requests of its problem
+			const int_t handle = queue.front()->handle;
+			batch.clear();
+			for (std::deque<Connection*>::iterator it = queue.begin(); it != queue.end() && batch.size() < MAX_BATCH;){
+				if ((*it)->handle == handle){
+					batch.push_back(*it);
+					it = queue.erase(it);
+				}else{
+					++it;
+				}
+			}
+		}
+		++nbatches;
+
+		for (size_t r = 0; r < batch.size(); ++r){
+			Connection *conn = batch[r];
+			MPCSolver &solver = *conn->solvers[conn->handle];
+			const int_t n = problems[conn->handle]->n, m = problems[conn->handle]->m;
+			for (int_t i = 0; i < conn->count; ++i){
+				solver.solve(&conn->x0[i*n]);
+				solver.getControlInputs(&conn->u[i*m]);
+				conn->iterations[i] = solver.getIterNumber();
+				conn->exitFlags[i] = solver.getExitFlag();
+			}
+			nstates += conn->count;
+			++nrequests;
+		}
+		for (size_t r = 0; r < batch.size(); ++r){
+			Connection *conn = batch[r];
+			{
+				std::lock_guard<std::mutex> lock(conn->mutex);
+				conn->done = true;
+			}
+			conn->solved.notify_one();
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "../DefineSettings.h"
+#include "../ProblemData.h"
+
+class MPCSolver;
+
+/*! \class SolverServer
+ * \brief Serves MPC solves for many controllers over a Unix domain socket (see DaemonProtocol.h).
+ *
+ * The problems are loaded once, each connection gets its own MPCSolver for each problem it uses,
+ * which shares the problem data, so a controller only costs the workspace of a solver. A thread per
+ * connection reads the requests and puts them in a queue. The workers take the oldest request
+ * together with all other queued requests of the same problem and solve them in one batch, so the
+ * matrices of the problem stay in the cache of the worker while the load is high. The responses are
+ * written by the connection threads.
+ */
+class SolverServer{
+public:
+	/*!
+	 * \brief constructor
+	 *
+	 * \param nworkers_i is the number of threads which solve the requests
+	 */
+	SolverServer(const int_t nworkers_i);
+
+	/// destructor: stops the server
+	~SolverServer();
+
+	/*!
+	 * \brief load a problem from a directory, before start
+	 * \return the handle of the problem for the requests, -1 if it cannot be loaded
+	 */
+	int_t	addProblem(const std::string &dir);
+
+	/*!
+	 * \brief listen on the socket path and start the threads
+	 * \return false if the socket cannot be created
+	 */
+	bool	start(const std::string &path_i);
+
+	/// close all connections, finish the queued requests and join the threads
+	void	stop();
+
+	/// returns the number of solved states
+	long	getNumberOfStates() const {return nstates;}
+
+	/// returns the number of requests
+	long	getNumberOfRequests() const {return nrequests;}
+
+	/// returns the number of batches taken by the workers
+	long	getNumberOfBatches() const {return nbatches;}
+
+private:
+	struct Connection;
+
+	/// accept connections until the socket is closed
+	void	acceptLoop();
+
+	/// read the requests of a connection and write the responses
+	void	serve(Connection *conn);
+
+	/// solve batches of queued requests
+	void	work();
+
+	int_t	nworkers;				///< threads which solve the requests
+
+	int		listenFd;				///< listening socket (-1 if not started)
+
+	std::string	path;				///< path of the socket
+
+	std::vector<std::shared_ptr<const ProblemData> >	problems;	///< problems of the handles
+
+	std::vector<Connection*>	connections;	///< open and closed connections, freed by stop
+
+	std::mutex					connMutex;		///< protects connections
+
+	std::deque<Connection*>		queue;			///< connections with a request to solve
+
+	std::mutex					queueMutex;		///< protects queue and stopping
+
+	std::condition_variable		queued;			///< signals a request to the workers
+
+	std::thread					acceptThread;
+
+	std::vector<std::thread>	workers;
+
+	bool	stopping;				///< workers exit when the queue is empty
+
+	std::atomic<long>	nstates,	///< solved states
+						nrequests,	///< solved requests
+						nbatches;	///< batches of the workers
+};
@@ -9,5 +9,8 @@ typedef unsigned int uint_t;
 // Infinity
 #define INFVAL 1e16
 
+// values below this are treated as zero in ratio tests of the active set methods
+#define EPSVAL 1e-12
+
 // maximum number of optimization variables (must be greater than nz+1)
 #define MAX_VARS 50
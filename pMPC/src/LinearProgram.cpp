@@ -0,0 +1,370 @@
+#include "LinearProgram.h"
+#include "Utils.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	/// relative violation of a constraint which is accepted
+	const real_t FEAS_TOL = 1e-9;
+
+	/// relative size of a negative multiplier which is accepted
+	const real_t OPT_TOL = 1e-10;
+
+	/// smallest pivot of the ratio tests
+	const real_t PIV_TOL = 1e-9;
+
+	/// smallest pivot of the factorization of the working set, the late time steps of the MOAS give working
+	/// sets which are much worse conditioned than a single exchange
+	const real_t SING_TOL = 1e-12;
+
+	/// rank one updates of the inverse between two refactorizations
+	const int_t REFACTOR = 64;
+}
+
+LinearProgram::LinearProgram(const int_t nx_i, const real_t bound_i): nx(nx_i), bound(bound_i){
+	nrows = 0;
+	nhalf = 2*nx;
+	updates = iterations = 0;
+
+	Binv.resize(nx*nx);
+	x.resize(nx);
+	y.resize(nx);
+	a.resize(nx);
+	d.resize(nx);
+	W.resize(nx);
+	inW.assign(nhalf, 0);
+	skip.assign(nhalf, 0);
+}
+
+void LinearProgram::setConstraints(const real_t *const A_i, const real_t *const lb_i, const real_t *const ub_i,
+	const int_t nrows_i){
+	nrows = nrows_i;
+	nhalf = 2*nx+2*nrows;
+	A.assign(A_i, A_i+nrows*nx);
+	lb.assign(lb_i, lb_i+nrows);
+	ub.assign(ub_i, ub_i+nrows);
+	scale.assign(nrows, 1.0);
+	for (int_t r = 0; r < nrows; ++r){
+		const real_t nrm = Utils::VectorNorm(&A[r*nx], nx);
+		if (nrm > 0){
+			Utils::ScalarVectorMult(&A[r*nx], 1.0/nrm, nx);
+			lb[r] /= nrm;
+			ub[r] /= nrm;
+			scale[r] = nrm;
+		}
+	}
+	inW.assign(nhalf, 0);
+	skip.assign(nhalf, 0);
+}
+
+void LinearProgram::setBounds(const int_t row, const real_t lb_i, const real_t ub_i){
+	lb[row] = lb_i/scale[row];
+	ub[row] = ub_i/scale[row];
+}
+
+bool LinearProgram::start(const real_t *const f, const std::vector<int_t> *const basis){
+	std::fill(inW.begin(), inW.end(), 0);
+	if (basis && (int_t)basis->size() == nx){
+		bool valid = true;
+		for (int_t i = 0; i < nx && valid; ++i){
+			valid = (*basis)[i] >= 0 && (*basis)[i] < nhalf && !inW[(*basis)[i]] && !std::isinf(rhs((*basis)[i]));
+			if (valid){
+				W[i] = (*basis)[i];
+				inW[W[i]] = 1;
+			}
+		}
+		if (valid && refactor()){
+			Utils::MatTVecMult(&Binv[0], f, &y[0], nx, nx);
+			const real_t tol = OPT_TOL*Utils::VectorInfNorm(f, nx);
+			if (Utils::min_value(&y[0], nx) >= -tol){
+				return true;
+			}
+		}
+		std::fill(inW.begin(), inW.end(), 0);
+	}
+
+	// optimal vertex of the box: x_i = bound*sign(f_i), multipliers |f_i|
+	std::fill(Binv.begin(), Binv.end(), 0.0);
+	for (int_t i = 0; i < nx; ++i){
+		W[i] = 2*i+((f[i] >= 0)?0:1);
+		inW[W[i]] = 1;
+		Binv[i*nx+i] = (f[i] >= 0)?1.0:-1.0;
+	}
+	updates = 0;
+	return false;
+}
+
+LPStatus LinearProgram::maximize(const real_t *const f, real_t &fval, std::vector<int_t> *const basis){
+	const bool warm = start(f, basis);
+	LPStatus status = iterate(f);
+	if (status == LP_FAILED && warm){
+		// the working set of the previous problem can lead into a degenerate corner, retry from the box
+		start(f, 0);
+		status = iterate(f);
+	}
+
+	if (status == LP_OPTIMAL && basis){
+		*basis = W;
+	}
+	Utils::DotProduct(f, &x[0], nx, fval);
+	return status;
+}
+
+LPStatus LinearProgram::iterate(const real_t *const f){
+	computeVertex();
+
+	LPStatus status = LP_FAILED;
+	int_t degenerate = 0;
+	const int_t maxIter = 10*nhalf;
+	const real_t ytol = OPT_TOL*Utils::VectorInfNorm(f, nx);
+	for (int_t it = 0; it < maxIter; ++it){
+		const bool bland = degenerate > 4*nx;
+
+		// the rounding errors of A x grow with x, nearly parallel rows of a degenerate vertex would otherwise
+		// enter and leave the working set in turn
+		const real_t xtol = FEAS_TOL*(1+Utils::VectorInfNorm(&x[0], nx));
+
+		// most violated half space (the rows are normalized), or the first one after degenerate steps
+		int_t r = -1;
+		real_t worst = 0;
+		for (int_t j = 0; j < 2*nx && !(bland && r >= 0); ++j){
+			const real_t val = product(j, &x[0])-bound;
+			if (!inW[j] && !skip[j] && val > FEAS_TOL*(1+bound) && val > worst){
+				worst = val;
+				r = j;
+			}
+		}
+		real_t prod[4];
+		for (int_t i = 0; i < nrows && !(bland && r >= 0); ++i){
+			if (i%4 == 0){
+				// four rows at a time
+				if (i+4 <= nrows){
+					Utils::DotProduct4(&A[i*nx], &x[0], nx, prod);
+				}else{
+					for (int_t k = i; k < nrows; ++k){
+						Utils::DotProduct(&A[k*nx], &x[0], nx, prod[k-i]);
+					}
+				}
+			}
+			const real_t val = prod[i%4];
+			if (!inW[2*nx+2*i] && !skip[2*nx+2*i] && val-ub[i] > xtol+FEAS_TOL*std::fabs(ub[i]) && val-ub[i] > worst){
+				worst = val-ub[i];
+				r = 2*nx+2*i;
+			}
+			if (!inW[2*nx+2*i+1] && !skip[2*nx+2*i+1] && lb[i]-val > xtol+FEAS_TOL*std::fabs(lb[i]) && lb[i]-val > worst){
+				worst = lb[i]-val;
+				r = 2*nx+2*i+1;
+			}
+		}
+		if (r < 0){
+			// violated half spaces which were skipped remain
+			status = skipped.empty()?LP_OPTIMAL:LP_FAILED;
+			break;
+		}
+
+		// multipliers of the working set: y = inv(B)'*f, z = inv(B)'*a_r
+		normal(r, &a[0]);
+		Utils::MatTVecMult(&Binv[0], f, &y[0], nx, nx);
+		Utils::MatTVecMult(&Binv[0], &a[0], &d[0], nx, nx);
+
+		// the leaving constraint keeps the multipliers nonnegative, multipliers below ytol count as zero
+		// so that near degenerate steps are treated as degenerate, the largest pivot breaks the ties
+		int_t q = -1;
+		bool small = false;
+		real_t ratio = 0;
+		for (int_t i = 0; i < nx; ++i){
+			if (pivot(i)){
+				const real_t val = (y[i] > ytol)?y[i]/d[i]:0.0;
+				if (q < 0 || val < ratio || (val == ratio && d[i] > d[q])){
+					ratio = val;
+					q = i;
+				}
+			}else{
+				small = small || d[i] > PIV_TOL;
+			}
+		}
+		if (q < 0){
+			if (!small){
+				// the row is a nonnegative combination of the working set
+				status = LP_INFEASIBLE;
+				break;
+			}
+			// the pivots would make the working set singular: the row is nearly a combination of the working
+			// set (e.g. a late time step of the MOAS), try the next violated half space
+			skip[r] = 1;
+			skipped.push_back(r);
+			continue;
+		}
+		if (bland){
+			// smallest half space among the ties of the ratio test
+			for (int_t i = 0; i < nx; ++i){
+				if (W[i] < W[q] && pivot(i) && ((y[i] > ytol)?y[i]/d[i]:0.0) <= ratio*(1+OPT_TOL)){
+					q = i;
+				}
+			}
+		}
+
+		// Bland's rule is kept until a step increases the dual objective
+		degenerate = (ratio == 0.0)?degenerate+1:0;
+
+		const int_t leaving = W[q];
+		if (!exchange(q, r) || !computeVertex()){
+			// the working set became singular after all: restore it and skip the row
+			inW[r] = 0;
+			inW[leaving] = 1;
+			W[q] = leaving;
+			if (!refactor()){
+				break;
+			}
+			computeVertex();
+			skip[r] = 1;
+			skipped.push_back(r);
+			continue;
+		}
+		for (size_t i = 0; i < skipped.size(); ++i){
+			skip[skipped[i]] = 0;
+		}
+		skipped.clear();
+	}
+
+	for (size_t i = 0; i < skipped.size(); ++i){
+		skip[skipped[i]] = 0;
+	}
+	skipped.clear();
+	return status;
+}
+
+bool LinearProgram::pivot(const int_t i) const{
+	if (d[i] <= PIV_TOL){
+		return false;
+	}
+	// the column i of the inverse is divided by the pivot in the exchange
+	real_t col = 1.0;
+	for (int_t k = 0; k < nx; ++k){
+		col = std::max(col, std::fabs(Binv[k*nx+i]));
+	}
+	return d[i] > PIV_TOL*col;
+}
+
+real_t LinearProgram::product(const int_t j, const real_t *const v) const{
+	real_t val;
+	if (j >= 2*nx){
+		Utils::DotProduct(&A[((j-2*nx)/2)*nx], v, nx, val);
+	}else{
+		val = v[j/2];
+	}
+	return (j%2 == 0)?val:-val;
+}
+
+real_t LinearProgram::rhs(const int_t j) const{
+	if (j >= 2*nx){
+		return (j%2 == 0)?ub[(j-2*nx)/2]:-lb[(j-2*nx)/2];
+	}
+	return bound;
+}
+
+void LinearProgram::normal(const int_t j, real_t *const a_j) const{
+	if (j >= 2*nx){
+		Utils::VectorCopy(&A[((j-2*nx)/2)*nx], a_j, nx);
+	}else{
+		std::fill(a_j, a_j+nx, 0.0);
+		a_j[j/2] = 1.0;
+	}
+	if (j%2 == 1){
+		Utils::ScalarVectorMult(a_j, -1.0, nx);
+	}
+}
+
+bool LinearProgram::exchange(const int_t q, const int_t j){
+	++iterations;
+	inW[W[q]] = 0;
+	inW[j] = 1;
+	W[q] = j;
+
+	if (++updates >= REFACTOR){
+		return refactor();
+	}
+
+	// row q of B becomes a: inv(B) -= u*(a'*inv(B)-e_q')/(a'*u) with u = inv(B)*e_q
+	normal(j, &a[0]);
+	Utils::MatTVecMult(&Binv[0], &a[0], &y[0], nx, nx);
+	const real_t den = y[q];
+	if (std::fabs(den) < PIV_TOL){
+		return refactor();
+	}
+	y[q] -= 1.0;
+	for (int_t k = 0; k < nx; ++k){
+		d[k] = Binv[k*nx+q]/den;
+	}
+	for (int_t k = 0; k < nx; ++k){
+		for (int_t i = 0; i < nx; ++i){
+			Binv[k*nx+i] -= d[k]*y[i];
+		}
+	}
+	return true;
+}
+
+bool LinearProgram::refactor(){
+	updates = 0;
+
+	// Gauss-Jordan elimination with partial pivoting of [B I]
+	std::vector<real_t> B(nx*nx);
+	for (int_t i = 0; i < nx; ++i){
+		normal(W[i], &B[i*nx]);
+	}
+	std::fill(Binv.begin(), Binv.end(), 0.0);
+	for (int_t i = 0; i < nx; ++i){
+		Binv[i*nx+i] = 1.0;
+	}
+	for (int_t j = 0; j < nx; ++j){
+		int_t piv = j;
+		for (int_t i = j+1; i < nx; ++i){
+			if (std::fabs(B[i*nx+j]) > std::fabs(B[piv*nx+j])){
+				piv = i;
+			}
+		}
+		if (std::fabs(B[piv*nx+j]) < SING_TOL){
+			return false;
+		}
+		std::swap_ranges(&B[j*nx], &B[j*nx]+nx, &B[piv*nx]);
+		std::swap_ranges(&Binv[j*nx], &Binv[j*nx]+nx, &Binv[piv*nx]);
+		const real_t p = 1.0/B[j*nx+j];
+		Utils::ScalarVectorMult(&B[j*nx], p, nx);
+		Utils::ScalarVectorMult(&Binv[j*nx], p, nx);
+		for (int_t i = 0; i < nx; ++i){
+			const real_t fac = B[i*nx+j];
+			if (i == j || fac == 0.0){
+				continue;
+			}
+			for (int_t k = 0; k < nx; ++k){
+				B[i*nx+k] -= fac*B[j*nx+k];
+				Binv[i*nx+k] -= fac*Binv[j*nx+k];
+			}
+		}
+	}
+	return true;
+}
+
+bool LinearProgram::computeVertex(){
+	for (int_t i = 0; i < nx; ++i){
+		d[i] = rhs(W[i]);
+	}
+	Utils::MatrixMult(&Binv[0], &d[0], &x[0], nx, nx, 1);
+	if (updates == 0){
+		return true;
+	}
+
+	// the rank one updates lose accuracy on nearly parallel constraints: refactorize if x is not on the
+	// half spaces of the working set
+	for (int_t i = 0; i < nx; ++i){
+		if (std::fabs(product(W[i], &x[0])-d[i]) > FEAS_TOL*(1+std::fabs(d[i]))){
+			if (!refactor()){
+				return false;
+			}
+			Utils::MatrixMult(&Binv[0], &d[0], &x[0], nx, nx, 1);
+			return true;
+		}
+	}
+	return true;
+}
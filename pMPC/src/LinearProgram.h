@@ -0,0 +1,122 @@
+#pragma once
+#include <vector>
+#include "DefineSettings.h"
+
+/// result of LinearProgram::maximize
+enum LPStatus{
+	LP_OPTIMAL,					///< the solution is optimal
+	LP_INFEASIBLE,				///< the constraints have no common point
+	LP_FAILED					///< the iteration limit was reached or the basis became singular
+};
+
+/*! \class LinearProgram
+ * \brief Dense simplex method for the small linear programs of the offline tools.
+ *
+ * LP formulation:
+ *	max		f^T x
+ *	s.t		lb <= A x <= ub,	-bound <= x <= bound
+ *
+ * The dual simplex method works on a working set of nx constraints and the inverse of their normals,
+ * which is updated with a rank one correction when a constraint is exchanged. It starts from the vertex
+ * of the box that is optimal for f, or from the working set of a previous problem if its multipliers
+ * are nonnegative for f, e.g. the same objective on more constraints or a slightly rotated objective.
+ * The rows of A are normalized internally. Multipliers below a tolerance relative to f count as zero in the
+ * ratio test, ties are broken by the largest pivot, and after 4*nx degenerate steps Bland's rule is used
+ * until a step increases the dual objective. The feasibility tolerance grows with the vertex. The pivots are
+ * relative to the inverse and the inverse is refactorized when the vertex is inaccurate, so nearly parallel
+ * constraints (e.g. the late time steps of the MOAS) do not make the working set singular. A violated
+ * constraint which would still make it singular is skipped until the next exchange, and a warm start which
+ * fails is repeated from the box.
+ */
+class LinearProgram{
+public:
+	/*!
+	 * \brief constructor
+	 *
+	 * \param nx_i is the number of variables
+	 * \param bound_i is the bound on the variables, it keeps every problem bounded
+	 */
+	LinearProgram(const int_t nx_i, const real_t bound_i = 1e6);
+
+	/*!
+	 * \brief set the constraints
+	 *
+	 * \param A contains nrows x nx constraints stored row wise (copied)
+	 * \param lb, ub are the bounds of A x, infinite bounds are ignored
+	 * \param nrows is the number of constraints
+	 */
+	void	setConstraints(const real_t *const A, const real_t *const lb, const real_t *const ub, const int_t nrows);
+
+	/// set the bounds of one row of the constraints, infinite bounds remove the row
+	void	setBounds(const int_t row, const real_t lb_i, const real_t ub_i);
+
+	/*!
+	 * \brief maximize f^T x, -f gives the minimum
+	 *
+	 * \param f contains the nx coefficients of the objective
+	 * \param fval returns the optimal value
+	 * \param basis is the working set to start from (ignored if empty or not dual feasible) and returns the
+	 * optimal working set. The half spaces are numbered as the box, then the rows, so a working set remains
+	 * valid if rows are appended to the constraints.
+	 */
+	LPStatus	maximize(const real_t *const f, real_t &fval, std::vector<int_t> *const basis = 0);
+
+	/// returns the solution of the last call to maximize
+	const real_t*	getSolution() const {return &x[0];}
+
+	/// returns the number of exchanges of all calls to maximize
+	int_t	getIterations() const {return iterations;}
+
+private:
+	/// start from basis if its multipliers are nonnegative for f (returns true), otherwise from the optimal
+	/// vertex of the box
+	bool	start(const real_t *const f, const std::vector<int_t> *const basis);
+
+	/// dual simplex iterations from the working set of start
+	LPStatus	iterate(const real_t *const f);
+
+	/// returns true if d[i] is a pivot which keeps the working set regular (relative to column i of the inverse)
+	bool	pivot(const int_t i) const;
+
+	/// returns a_j^T v for the half space j: 2*i and 2*i+1 are x_i <= bound and -x_i <= bound,
+	/// 2*nx+2*i and 2*nx+2*i+1 are A_i x <= ub_i and -A_i x <= -lb_i
+	real_t	product(const int_t j, const real_t *const v) const;
+
+	/// returns the right hand side of the half space j
+	real_t	rhs(const int_t j) const;
+
+	/// copy the normal of the half space j to a
+	void	normal(const int_t j, real_t *const a) const;
+
+	/// replace the constraint at position q of the working set by the half space j
+	bool	exchange(const int_t q, const int_t j);
+
+	/// invert the normals of the working set from scratch, false if they are singular
+	bool	refactor();
+
+	/// x = inv(B)*b of the working set, refactorizes if x is inaccurate, false if the working set is singular
+	bool	computeVertex();
+
+	int_t	nx,					///< number of variables
+			nrows,				///< number of constraints
+			nhalf,				///< number of half spaces including the box
+			updates,			///< rank one updates since the last refactorization
+			iterations;			///< number of exchanges
+
+	real_t	bound;				///< bound on the variables
+
+	std::vector<real_t>	A,		///< normalized constraints
+						lb,		///< normalized lower bounds
+						ub,		///< normalized upper bounds
+						scale,	///< norms of the rows of A
+						Binv,	///< inverse of the normals of the working set (nx x nx)
+						x,		///< current vertex
+						y,		///< multipliers of the working set
+						a,		///< workspace of one normal
+						d;		///< workspace of one direction
+
+	std::vector<int_t>	W;		///< half spaces of the working set
+	std::vector<char>	inW,	///< flags of the half spaces in the working set
+						skip;	///< flags of the half spaces skipped since the last exchange
+	std::vector<int_t>	skipped;	///< half spaces skipped since the last exchange
+};
@@ -1,126 +1,223 @@
 #include "MPCSolver.h"
 #include "Utils.h"
+#include "Trace.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <thread>
+
+MPCSolver::MPCSolver(std::string dir): QPSolver(ProblemData::load(dir)){
+	initializeMPC();
+}
 
-MPCSolver::MPCSolver(std::string dir): QPSolver(dir){
-	std::string tmp;
-	int_t tmp2;
-			
-	// Basic paramters
-	{
-		tmp=dir+"/params";
-		int_t nparams;
-		real_t *tmpvec;
-		
-		Utils::LoadVec(tmp.c_str(),&tmpvec,nparams);
-		
-		n = (int_t)tmpvec[5];
-		m = (int_t)tmpvec[6];
-		s = (int_t)tmpvec[7];
+MPCSolver::MPCSolver(std::shared_ptr<const ProblemData> data_i): QPSolver(data_i){
+	initializeMPC();
+}
 
-		delete [] tmpvec;
-	}
-	
-	tmp=dir+"/AiC";
-	Utils::LoadVec(tmp.c_str(),&AiC,tmp2);			// tmp2 = nc*n
+void MPCSolver::initializeMPC(){
+	assert(data->hasMPCData() && "problem data does not contain the MPC matrices");
 
-	tmp=dir+"/C";
-	Utils::LoadVec(tmp.c_str(),&C,tmp2);			
+	n = data->n;
+	m = data->m;
+	s = data->s;
+	t_star = data->t_star;
+	m_np = data->np;
+	m_nw = m_np*s;
 
-	tmp=dir+"/eta2u";
-	Utils::LoadVec(tmp.c_str(),&eta2u,tmp2);		
-	
-	tmp=dir+"/Z";
-	Utils::LoadVec(tmp.c_str(),&Z,tmp2);			
-	
-	tmp=dir+"/F";
-	Utils::LoadVec(tmp.c_str(),&F,tmp2);
-	
-	tmp=dir+"/C0";
-	Utils::LoadVec(tmp.c_str(),&C0,tmp2);
-	
-	tmp=dir+"/C1";
-	Utils::LoadVec(tmp.c_str(),&C1,tmp2);
-	
-	tmp=dir+"/time_indices";
-	Utils::LoadVec(tmp.c_str(),&time_indices,tmp2);
+	setMPCMatrices();
 
-	tmp=dir+"/norms";
-	Utils::LoadVec(tmp.c_str(),&norms,tmp2);
+	eta_u = new real_t[m*s]();
+	u = new real_t[m]();
+	x0 = new real_t[n]();
 
-	tmp=dir+"/tauk";
-	Utils::LoadVec(tmp.c_str(),&tauk,tmp2);
-	
-	t_star = static_cast<int_t>(tmp2/s);
+	// choose method with less number of variables
+	est_lbErr = est_ubErr = eta_w = norm_w = w_x0 = par_est = 0;
+	stepOffset = 0;
+	strategy = DENSE_CHECK;
+	if ((s<=nz || data->isFactored()) && data->hasSkipData()){
+		setCheckStrategy(SKIP_CHECK);
+	}
 
-	tmp=dir+"/b_u";
-	Utils::LoadVec(tmp.c_str(),&b_u,tmp2);
+	F_own = staged_Li = staged_LiTLi = staged_F = 0;
+	retunePending = false;
+	b_l_own = b_u_own = 0;
+	exactCheck = 0;
+	swapState = SWAP_IDLE;
+	swapRunning = false;
+	swapAbort = false;
+	recorder = 0;
+
+	autoTune = false;
+	tuning.strategy = strategy;
+	tuning.kernelWidth = getCheckKernelWidth();
+	tuning.threads = 1;
+	tuning.time = 0;
+	tuning.calibrated = false;
+}
 
-	tmp=dir+"/b_l";
-	Utils::LoadVec(tmp.c_str(),&b_l,tmp2);
-	
-	m_np = tmp2;
-	m_nw = m_np*s;
-	
+bool MPCSolver::setCheckStrategy(const CheckStrategy strategy_i){
+	if (strategy_i == DENSE_CHECK && data->isFactored()){
+		return false;
+	}
+	if (strategy_i == SKIP_CHECK){
+		if (!data->hasSkipData()){
+			return false;
+		}
+		if (!eta_w){
+			// workspace of the skip constraints method
+			est_lbErr = new real_t[m_np]();	
+			est_ubErr = new real_t[m_np]();
+			eta_w = new real_t[m_nw]();
+			norm_w = new real_t[m_np]();
+			w_x0 = new real_t[m_nw];
+			stepOffset = new int_t[t_star+1];
+			computeStepOffsets();
+		}
+	}
+	strategy = strategy_i;
+	return true;
+}
 
-	eta_u = new real_t[m*s]();
-	est_lbErr = new real_t[m_np]();	
-	est_ubErr = new real_t[m_np]();
-	eta_w = new real_t[m_nw]();
-	norm_w = new real_t[m_np]();
-	temp_nw = new real_t[m_nw];
-	temp_nc = new real_t[nc]();
-	lbineq_c = new real_t[nc]();
-	ubineq_c = new real_t[nc]();
-	u = new real_t[m]();
-	
-	Utils::VectorCopy(lbineq,lbineq_c,nc);
-	Utils::VectorCopy(ubineq,ubineq_c,nc);
+void MPCSolver::setMPCMatrices(){
+	AiC = data->AiC;
+	C = data->C;
+	eta2u = data->eta2u;
+	Z = data->Z;
+	F = data->F;
+	C0 = data->C0;
+	C1 = data->C1;
+	time_indices = data->time_indices;
+	norms = data->norms;
+	tauk = data->tauk;
+	b_u = data->b_u;
+	b_l = data->b_l;
+
+	// bounds lbineq_c - AiC*x0 are evaluated where they are needed
+	Aipar = AiC;
+	npar = n;
+}
+
+bool MPCSolver::setProblemData(std::shared_ptr<const ProblemData> data_i){
+	if (!data_i->hasMPCData() || !data_i->isCompatible(*data) || (strategy == SKIP_CHECK && !data_i->hasSkipData()) ||
+		(strategy == DENSE_CHECK && data_i->isFactored())){
+		printf("problem data is not compatible with this solver.\n");
+		return false;
+	}
+
+	// setCostWeights copies data under retuneMutex, the weights staged for the old problem are dropped
+	{
+		std::lock_guard<std::mutex> lock(retuneMutex);
+		setQPData(data_i);
+		retunePending = false;
+		staged_data.reset();
+		delete[] F_own;
+		F_own = 0;
+	}
+	releaseOwnBounds();
+	setMPCMatrices();
+	if (stepOffset){
+		computeStepOffsets();
+	}
+	return true;
 }
 
 MPCSolver::~MPCSolver(){
+	if (swapThread.joinable()){
+		{
+			std::lock_guard<std::mutex> lock(swapMutex);
+			swapAbort = true;
+		}
+		swapDone.notify_one();
+		swapThread.join();
+	}
 	delete[] eta_u;
 	delete[] est_lbErr;
 	delete[] est_ubErr;
 	delete[] eta_w;
 	delete[] norm_w;
-	delete[] temp_nw;
-	delete[] temp_nc;
-	delete[] lbineq_c;
-	delete[] ubineq_c;
+	delete[] w_x0;
+	delete[] par_est;
+	delete[] stepOffset;
 	delete[] u;
-
-	delete[] AiC;
-	delete[] C;
-	delete[] eta2u;
-	delete[] Z;
-	delete[] F;
-	delete[] C0;
-	delete[] C1;
-	delete[] time_indices;
-	delete[] norms;
-	delete[] tauk;
-	delete[] b_u;
-	delete[] b_l;
+	delete[] x0;
+	delete[] F_own;
+	delete[] staged_Li;
+	delete[] staged_LiTLi;
+	delete[] staged_F;
+	releaseOwnBounds();
+	delete recorder;
 }
 
 void MPCSolver::updateMPCProblem(const real_t *const x_IC ){
+	PMPC_TRACE_SCOPE("updateMPCProblem");
 	// update linear cost g = F*x0;
 	Utils::MatVecMult(F,x_IC,g,nz,n);
 	
-	// update bounds on inequality constraint	 lbineq = lbineq_c - AiC*x0;
-	
-	Utils::MatVecMult(AiC,x_IC,temp_nc,nc,n);
-	for(int_t k=0;k<nc;++k){				// for each constraint
-		
-		// update bounds
-		lbineq[k] = lbineq_c[k] - temp_nc[k];
-		ubineq[k] = ubineq_c[k] - temp_nc[k];
-		
+	// w_x0 = C0*x0 is used by the skip constraints method and the bounds of factored data
+	if (w_x0){
+		Utils::MatVecMult(C0,x_IC,w_x0,m_nw,n);
 	}
+
+	// bounds on inequality constraints lbineq = lbineq_c - AiC*x0: only the bounds of the active
+	// constraints are stored, the others are evaluated by the constraint check. The bounds are also
+	// evaluated after solve returns (e.g. by setConstraintBounds), so par points to a copy of x0.
+	Utils::VectorCopy(x_IC,x0,n);
+	par = x0;
+	activeCons->refreshBounds();
 }
 
 void MPCSolver::solve(const real_t *const x_IC){
-	x0 = x_IC;
+	PMPC_TRACE_SCOPE("MPCSolver::solve");
+	if (swapState == SWAP_READY){
+		applySwap();
+	}
+	if (retunePending){
+		applyCostWeights();
+	}
+
+	if (autoTune && !tuning.calibrated){
+		// calibrate with scaled copies of the first state
+		const real_t scale[4] = {1.0, 0.5, -1.0, 2.0};
+		real_t *x_samples = new real_t[4*n];
+		for (int_t k=0; k<4; ++k){
+			Utils::VectorCopy(x_IC,&x_samples[k*n],n);
+			Utils::ScalarVectorMult(&x_samples[k*n],scale[k],n);
+		}
+		autotune(x_samples,4);
+		delete[] x_samples;
+	}
+
+	solveStep(x_IC);
+
+	if (recorder){
+		recorder->append(x_IC, u, getIterNumber(), getExitFlag());
+	}
+}
+
+bool MPCSolver::startRecording(const std::string &file, const bool outputs){
+	stopRecording();
+	std::vector<char> snapshot(getSnapshotSize());
+	saveSnapshot(snapshot.data());
+
+	recorder = new StateLog();
+	if (!recorder->create(file.c_str(), n, m, outputs, snapshot.data(), (int_t)snapshot.size())){
+		stopRecording();
+		return false;
+	}
+	return true;
+}
+
+void MPCSolver::stopRecording(){
+	delete recorder;
+	recorder = 0;
+}
+
+void MPCSolver::solveStep(const real_t *const x_IC){
 	// update the parameters depending on x0
 	updateMPCProblem(x_IC);
 
@@ -145,9 +242,118 @@ void MPCSolver::solve(const real_t *const x_IC){
 	}
 }
 
+void MPCSolver::autotune(const real_t *const x_samples, const int_t nsamples){
+	const int_t nrep = 5;						// the fastest of nrep passes is used
+	const CheckStrategy strategies[2] = {DENSE_CHECK, SKIP_CHECK};
+	const int_t widths[2] = {1, 4};
+
+	// thread counts 1, 2, 4, ... up to the number of cores, if the problem is large enough
+	std::vector<int_t> threads(1, 1);
+	const int_t ncores = (int_t)std::thread::hardware_concurrency();
+	for (int_t t=2; t<=ncores && nc>=parThreshold; t*=2){
+		threads.push_back(t);
+	}
+	if (ncores>1 && threads.back()!=ncores && nc>=parThreshold){
+		threads.push_back(ncores);
+	}
+
+	CheckTuning best = tuning;
+	best.time = INFVAL;
+
+	for (int_t i=0; i<2; ++i){
+		if (!setCheckStrategy(strategies[i])){
+			continue;
+		}
+		for (int_t j=0; j<2; ++j){
+			if (strategies[i] == SKIP_CHECK && j>0){
+				// the kernel width is only used by the dense check
+				continue;
+			}
+			setCheckKernelWidth(widths[j]);
+
+			for (size_t l=0; l<threads.size(); ++l){
+				setNumThreads(threads[l]);
+
+				real_t time = INFVAL;
+				for (int_t rep=0; rep<nrep; ++rep){
+					// every pass starts cold
+					activeCons->resetActiveSet();
+					TOL = tolMin;
+
+					std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+					for (int_t k=0; k<nsamples; ++k){
+						solveStep(&x_samples[k*n]);
+					}
+					std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+					time = std::min(time, (real_t)std::chrono::duration<double, std::micro>(t1-t0).count());
+				}
+				time /= nsamples;
+
+				if (time < best.time){
+					best.strategy = strategies[i];
+					best.kernelWidth = widths[j];
+					best.threads = threads[l];
+					best.time = time;
+				}
+			}
+		}
+	}
+
+	setCheckStrategy(best.strategy);
+	setCheckKernelWidth(best.kernelWidth);
+	setNumThreads(best.threads);
+	activeCons->resetActiveSet();
+	TOL = tolMin;
+
+	tuning = best;
+	tuning.calibrated = true;
+	saveTuning();
+}
+
+void MPCSolver::setAutoTuning(const bool enable){
+	autoTune = enable;
+	if (autoTune && !tuning.calibrated){
+		// use the decision of an earlier calibration if there is one
+		loadTuning();
+	}
+}
+
+bool MPCSolver::loadTuning(){
+	std::string tmp = data->dir+"/tuning";
+	if (data->dir.empty() || !Utils::FileExists(tmp.c_str())){
+		return false;
+	}
+
+	real_t *tmpvec;
+	int_t nv;
+	Utils::LoadVec(tmp.c_str(),&tmpvec,nv);
+
+	bool ok = (nv>=4) && setCheckStrategy((CheckStrategy)(int_t)tmpvec[0]);
+	if (ok){
+		setCheckKernelWidth((int_t)tmpvec[1]);
+		setNumThreads((int_t)tmpvec[2]);
+		tuning.strategy = strategy;
+		tuning.kernelWidth = getCheckKernelWidth();
+		tuning.threads = getNumThreads();
+		tuning.time = tmpvec[3];
+		tuning.calibrated = true;
+	}
+	delete[] tmpvec;
+	return ok;
+}
+
+void MPCSolver::saveTuning() const{
+	if (data->dir.empty()){
+		return;
+	}
+	std::string tmp = data->dir+"/tuning";
+	real_t tmpvec[4] = {(real_t)tuning.strategy, (real_t)tuning.kernelWidth, (real_t)tuning.threads, tuning.time};
+	Utils::SaveVec(tmp.c_str(),tmpvec,4);
+}
+
 void MPCSolver::checkConstraints(){
-	// choose method with less number of variables
-	if(s>nz){	
+	if(strategy == DENSE_CHECK){	
+		// dense check, the bounds are evaluated in the same loop
 		QPSolver::checkConstraints();
 	}else{
 		checkConstraints_skip();
@@ -155,10 +361,10 @@ void MPCSolver::checkConstraints(){
 }
 
 void MPCSolver::checkConstraints_skip(){
+	PMPC_TRACE_SCOPE("checkConstraints_skip");
 	//eta_w = C0*x0 + C1*z
-	Utils::MatVecMult(C0,x0,temp_nw,m_nw,n);
 	Utils::MatVecMult(C1,z,eta_w,m_nw,nz);
-	Utils::VectorAdd(eta_w,temp_nw,eta_w,m_nw);
+	Utils::VectorAdd(eta_w,w_x0,eta_w,m_nw);
 	
 	for (int i=0;i<m_np;++i){
 		norm_w[i] = Utils::VectorNorm(&eta_w[i*s],s);
@@ -182,8 +388,14 @@ void MPCSolver::checkConstraints_skip(){
 		++idx1;
 
 		Utils::DotProduct(tauk, &eta_w[i*s], s, val);
-		est_ubErr[i] = val - b_u[i];
-		est_lbErr[i] = b_l[i] - val;
+		if (exactCheck && exactCheck[i]){
+			// bounds of the row
+			est_ubErr[i] = val - ubineq[idx1-1];
+			est_lbErr[i] = lbineq[idx1-1] - val;
+		}else{
+			est_ubErr[i] = val - b_u[i];
+			est_lbErr[i] = b_l[i] - val;
+		}
 
 		if (est_ubErr[i]>max_error) {
 			max_error = est_ubErr[i];
@@ -198,30 +410,48 @@ void MPCSolver::checkConstraints_skip(){
 
 
 	// skip constraints loop
-	for(int i = 0; i < t_star; ++i){
+	if (isParallel()){
+		checkSkipParallel(max_error, viol_idx);
+	}else{
+		checkSkipSteps(0, t_star, idx1, est_lbErr, est_ubErr, max_error, viol_idx);
+	}
+	
+	viol = (max_error>TOL);
+	n_viol = viol?1:0;				// only the maximum violation is known exactly
+		
+}
+
+void MPCSolver::checkSkipSteps(const int_t i_begin, const int_t i_end, int_t idx1, real_t *const est_lb, 
+	real_t *const est_ub, real_t &max_error, int_t &max_idx) const{
+	real_t val;
+
+	for(int i = i_begin; i < i_end; ++i){
 		for(int k = 0; k<m_np; ++k){
 				
 			if(time_indices[(i+1)*m_np+k]>0){ // constraint is in non-redundant set
 				++idx1;
 				
+				// constraints with bounds which differ between time steps are evaluated exactly
+				const bool exact = (exactCheck && exactCheck[k]);
+
 				// update estimates
-				est_ubErr[k] += norms[i]*norm_w[k];
-				est_lbErr[k] += norms[i]*norm_w[k];
+				est_ub[k] += norms[i]*norm_w[k];
+				est_lb[k] += norms[i]*norm_w[k];
 
-				if (est_ubErr[k] > max_error || est_lbErr[k] > max_error){
+				if (exact || est_ub[k] > max_error || est_lb[k] > max_error){
 					// estimate crosses bound: find exact value
 					Utils::DotProduct(&tauk[(i+1)*s],&eta_w[k*s],s,val);
-					est_ubErr[k] = val - b_u[k]; 
-					est_lbErr[k] = b_l[k] - val;
+					est_ub[k] = val - (exact?ubineq[idx1-1]:b_u[k]); 
+					est_lb[k] = (exact?lbineq[idx1-1]:b_l[k]) - val;
 
-					if(est_ubErr[k]>max_error){
-						max_error = est_ubErr[k];
-						viol_idx = idx1;
+					if(est_ub[k]>max_error){
+						max_error = est_ub[k];
+						max_idx = idx1;
 					}
 
-					if(est_lbErr[k]>max_error){
-						max_error = est_lbErr[k];
-						viol_idx = -idx1;
+					if(est_lb[k]>max_error){
+						max_error = est_lb[k];
+						max_idx = -idx1;
 					}
 
 				}
@@ -229,14 +459,380 @@ void MPCSolver::checkConstraints_skip(){
 			}
 		}
 	}
+}
 
-	
-	viol = (max_error>TOL);
-		
+void MPCSolver::checkSkipParallel(real_t &max_error, int_t &max_idx){
+	const int_t nthreads = pool->getNumThreads();
+
+	pool->run([this, nthreads, max_error, max_idx](const int_t t){
+		const int_t i_begin = (t*t_star)/nthreads,
+					i_end = ((t+1)*t_star)/nthreads;
+		real_t	*est_lb = &par_est[2*t*m_np],
+				*est_ub = &par_est[(2*t+1)*m_np];
+		real_t err = -INFVAL;
+		int_t idx = 0;
+
+		if (t == 0){
+			// continue from the estimates at t=0
+			Utils::VectorCopy(est_lbErr, est_lb, m_np);
+			Utils::VectorCopy(est_ubErr, est_ub, m_np);
+			err = max_error;
+			idx = max_idx;
+		}else{
+			// the first row of each constraint in the block is evaluated exactly
+			for (int_t k = 0; k<m_np; ++k){
+				est_lb[k] = INFVAL;
+				est_ub[k] = INFVAL;
+			}
+		}
+
+		checkSkipSteps(i_begin, i_end, stepOffset[i_begin], est_lb, est_ub, err, idx);
+		par_err[t] = err;
+		par_idx[t] = idx;
+	});
+
+	// reduce in the order of the rows: the first maximum is kept as in the serial check
+	max_error = -INFVAL;
+	for (int_t t = 0; t<nthreads; ++t){
+		if (par_err[t] > max_error){
+			max_error = par_err[t];
+			max_idx = par_idx[t];
+		}
+	}
 }
+
+void MPCSolver::computeStepOffsets(){
+	// rows before the time step: the input constraints at t=0, then the rows of time_indices
+	stepOffset[0] = m;
+	for (int_t i = 0; i < t_star; ++i){
+		stepOffset[i+1] = stepOffset[i];
+		for (int_t k = 0; k<m_np; ++k){
+			if (time_indices[(i+1)*m_np+k]>0){
+				++stepOffset[i+1];
+			}
+		}
+	}
+}
+
+void MPCSolver::setNumThreads(const int_t nthreads){
+	QPSolver::setNumThreads(nthreads);
+
+	delete[] par_est;
+	par_est = 0;
+	if (nthreads > 1 && m_np > 0){
+		par_est = new real_t[2*nthreads*m_np];
+	}
+}
+
 void MPCSolver::getControlInputs(real_t *u_out) const{
 	for(int i=0;i<m;++i){
 	u_out[i] = u[i];
 	}
 	// printf("input is %f.\n",u[0]);
-}
\ No newline at end of file
+}
+
+int_t MPCSolver::getSnapshotSize() const{
+	return QPSolver::getSnapshotSize() + m*sizeof(real_t);
+}
+
+void MPCSolver::saveSnapshot(char *const buf) const{
+	const int_t nqp = QPSolver::getSnapshotSize();
+	QPSolver::saveSnapshot(buf);
+	memcpy(&buf[nqp], u, m*sizeof(real_t));
+}
+
+bool MPCSolver::restoreSnapshot(const char *const buf, const int_t size){
+	const int_t nqp = size - m*sizeof(real_t);
+	if (nqp < 0 || !QPSolver::restoreSnapshot(buf, nqp)){
+		return false;
+	}
+	memcpy(u, &buf[nqp], m*sizeof(real_t));
+	return true;
+}
+
+bool MPCSolver::setCostWeights(const real_t *const q, const real_t *const r){
+	// the problem can be switched by the thread of solve in the meantime, the copy keeps it alive
+	// (the dimensions are fixed at construction, setProblemData only accepts compatible problems)
+	std::shared_ptr<const ProblemData> data_i;
+	{
+		std::lock_guard<std::mutex> lock(retuneMutex);
+		data_i = data;
+	}
+	const int_t nv = (n+m)*s;
+
+	// diagonal of H in the order of eta = [eta_x; eta_u]
+	real_t *h = new real_t[nv];
+	for (int_t i = 0; i<n; ++i){
+		for (int_t k = 0; k<s; ++k){
+			h[i*s+k] = q[i];
+		}
+	}
+	for (int_t i = 0; i<m; ++i){
+		for (int_t k = 0; k<s; ++k){
+			h[(n+i)*s+k] = r[i];
+		}
+	}
+
+	// G = Z'*H*Z = L*L', Li = inv(L), LiTLi = Li'*Li, F = Z'*H*C
+	real_t *G = new real_t[nz*nz];
+	real_t *L = new real_t[nz*nz];
+	real_t *Li_i = new real_t[nz*nz];
+	real_t *LiTLi_i = new real_t[nz*nz];
+	real_t *F_i = new real_t[nz*n];
+	Utils::MatTDiagMatMult(data_i->Z, h, data_i->Z, G, nv, nz, nz);
+	const bool ok = Utils::Cholesky(G, L, nz);
+	if (ok){
+		Utils::LowerTriangularInverse(L, Li_i, nz);
+		Utils::MatrixTranspose(Li_i, G, nz, nz);
+		Utils::MatrixMult(G, Li_i, LiTLi_i, nz, nz, nz);
+		Utils::MatTDiagMatMult(data_i->Z, h, data_i->C, F_i, nv, nz, n);
+	}else{
+		printf("cost weights do not give a positive definite Hessian.\n");
+	}
+
+	if (ok){
+		// publish for the next solve
+		std::lock_guard<std::mutex> lock(retuneMutex);
+		if (!staged_Li){
+			staged_Li = new real_t[nz*nz];
+			staged_LiTLi = new real_t[nz*nz];
+			staged_F = new real_t[nz*n];
+		}
+		Utils::VectorCopy(Li_i, staged_Li, nz*nz);
+		Utils::VectorCopy(LiTLi_i, staged_LiTLi, nz*nz);
+		Utils::VectorCopy(F_i, staged_F, nz*n);
+		staged_data = data_i;
+		retunePending = true;
+	}
+
+	delete[] h;
+	delete[] G;
+	delete[] L;
+	delete[] Li_i;
+	delete[] LiTLi_i;
+	delete[] F_i;
+	return ok;
+}
+
+void MPCSolver::applyCostWeights(){
+	std::lock_guard<std::mutex> lock(retuneMutex);
+	if (!retunePending){
+		return;
+	}
+	retunePending = false;
+	if (staged_data != data){
+		// computed from a problem which was switched in the meantime
+		staged_data.reset();
+		return;
+	}
+	staged_data.reset();
+
+	replaceHessianFactor(staged_Li, staged_LiTLi);
+
+	if (!F_own){
+		F_own = new real_t[nz*n];
+	}
+	Utils::VectorCopy(staged_F, F_own, nz*n);
+	F = F_own;
+}
+
+bool MPCSolver::setConstraintBounds(const int_t k, const real_t lb, const real_t ub){
+	// all time steps, whatever the length of time_indices
+	if (!setRowBounds(k, 0, std::numeric_limits<int_t>::max(), lb, ub)){
+		return false;
+	}
+
+	if (!b_l_own){
+		b_l_own = new real_t[m_np];
+		b_u_own = new real_t[m_np];
+		Utils::VectorCopy(b_l, b_l_own, m_np);
+		Utils::VectorCopy(b_u, b_u_own, m_np);
+		b_l = b_l_own;
+		b_u = b_u_own;
+	}
+	b_l_own[k] = lb;
+	b_u_own[k] = ub;
+
+	// the estimates of the skip constraints method are valid again for k
+	if (exactCheck){
+		exactCheck[k] = false;
+	}
+	return true;
+}
+
+bool MPCSolver::setConstraintBounds(const int_t k, const int_t t_begin, const int_t t_end, const real_t lb, const real_t ub){
+	if (!setRowBounds(k, t_begin, t_end, lb, ub)){
+		return false;
+	}
+
+	if (!exactCheck){
+		exactCheck = new bool[m_np]();
+	}
+	exactCheck[k] = true;
+	return true;
+}
+
+bool MPCSolver::setRowBounds(const int_t k, const int_t t_begin, const int_t t_end, const real_t lb, const real_t ub){
+	if (k < 0 || k >= m_np || lb > ub || !data->hasRowMap()){
+		printf("bounds of constraint %d cannot be changed.\n", k);
+		return false;
+	}
+
+	allocateOwnBounds();
+	const int_t *const row_step = data->row_step;
+	const int_t *const row_constraint = data->row_constraint;
+	for (int_t i = 0; i < nc; ++i){
+		if (row_constraint[i] == k && row_step[i] >= t_begin && row_step[i] < t_end){
+			lbineq_own[i] = lb;
+			ubineq_own[i] = ub;
+		}
+	}
+
+	// bounds of the active constraints
+	activeCons->refreshBounds();
+	return true;
+}
+
+void MPCSolver::releaseOwnBounds(){
+	if (b_l_own){
+		b_l = data->b_l;
+		b_u = data->b_u;
+	}
+	delete[] b_l_own;
+	delete[] b_u_own;
+	delete[] exactCheck;
+	b_l_own = b_u_own = 0;
+	exactCheck = 0;
+}
+
+bool MPCSolver::swapProblemData(const std::string &dir){
+	if (swapRunning){
+		return false;
+	}
+	if (swapThread.joinable()){
+		// the last thread has returned
+		swapThread.join();
+	}
+
+	swapState = SWAP_LOADING;
+	swapRunning = true;
+	swapAbort = false;
+	swapThread = std::thread(&MPCSolver::swapWorker, this, dir, data, data->hasSkipData());
+	return true;
+}
+
+void MPCSolver::swapWorker(const std::string dir, std::shared_ptr<const ProblemData> current, const bool loadAll){
+	// ProblemData cannot report missing files
+	const bool factored = current->isFactored();
+	std::vector<std::string> files = {"params","Li","g","lbineq","ubineq","C","eta2u","Z","F",
+		"b_l","b_u","time_indices"};
+	if (!factored){
+		files.push_back("AiZ");
+		files.push_back("AiC");
+	}
+	if (loadAll){
+		files.push_back("C0");
+		files.push_back("C1");
+		files.push_back("tauk");
+		files.push_back("norms");
+	}
+	bool ok = true;
+	for (size_t i = 0; i < files.size() && ok; ++i){
+		const std::string name = dir+"/"+files[i]+".txt";
+		FILE *file = fopen(name.c_str(), "r");
+		if (file){
+			fclose(file);
+		}else{
+			printf("unable to read file %s\n", name.c_str());
+			ok = false;
+		}
+	}
+
+	std::shared_ptr<const ProblemData> data_i;
+	if (ok){
+		data_i = std::make_shared<const ProblemData>(dir, loadAll, factored);
+		ok = data_i->hasMPCData() && data_i->isCompatible(*current) && 
+			(!loadAll || data_i->hasSkipData()) && data_i->isFinite();
+		if (!ok){
+			printf("problem data in %s is not compatible with this solver.\n", dir.c_str());
+		}
+	}
+	current.reset();
+
+	std::unique_lock<std::mutex> lock(swapMutex);
+	if (ok && !swapAbort){
+		// publish, solve switches at its next call
+		swapData = data_i;
+		data_i.reset();
+		swapState = SWAP_READY;
+		swapDone.wait(lock, [this]{return swapState != SWAP_READY || swapAbort;});
+	}else{
+		swapState = SWAP_FAILED;
+	}
+
+	// free the old problem here unless other solvers still use it
+	std::shared_ptr<const ProblemData> old;
+	old.swap(retired);
+	swapData.reset();
+	lock.unlock();
+	old.reset();
+	data_i.reset();
+	swapRunning = false;
+}
+
+void MPCSolver::applySwap(){
+	std::unique_lock<std::mutex> lock(swapMutex);
+	std::shared_ptr<const ProblemData> data_i;
+	data_i.swap(swapData);
+	if (!data_i){
+		return;
+	}
+
+	// the reference of the solver moves to retired, so the old problem is freed by swapThread
+	std::shared_ptr<const ProblemData> old = data;
+	if (setProblemData(data_i)){
+		retired.swap(old);
+		swapState = SWAP_IDLE;
+	}else{
+		// e.g. the constraint check changed since the load
+		retired.swap(data_i);
+		swapState = SWAP_FAILED;
+	}
+	lock.unlock();
+	swapDone.notify_one();
+}
+
+real_t MPCSolver::getBound(const int_t idx) const{
+	if (AiZ){
+		return QPSolver::getBound(idx);
+	}
+
+	// AiC(i,:)*x0 = tauk(t)'*C0(k)*x0, no shift before the first state is set
+	const int_t i = Utils::absolute(idx)-1;
+	real_t shift = 0;
+	if (par){
+		Utils::DotProduct(&tauk[data->row_step[i]*s],&w_x0[data->row_constraint[i]*s],s,shift);
+	}
+	return (idx>0)?ubineq[i]-shift:shift-lbineq[i];
+}
+
+void MPCSolver::getRow(const int_t i, real_t *const row) const{
+	if (AiZ){
+		QPSolver::getRow(i, row);
+		return;
+	}
+
+	// AiZ(i,:) = tauk(t)'*C1(k), C1(k) are the s rows of constraint k
+	Utils::MatTVecMult(&C1[data->row_constraint[i]*s*nz],&tauk[data->row_step[i]*s],row,s,nz);
+}
+
+real_t MPCSolver::evaluateRow(const int_t i, const real_t *const x) const{
+	const real_t *const tau = &tauk[data->row_step[i]*s];
+	const real_t *const C1k = &C1[data->row_constraint[i]*s*nz];
+	real_t val = 0, prod;
+	for (int_t j = 0; j < s; ++j){
+		Utils::DotProduct(&C1k[j*nz],x,nz,prod);
+		val += tau[j]*prod;
+	}
+	return val;
+}
@@ -1,6 +1,35 @@
 #pragma once
 
 #include "QPSolver.h"
+#include "StateLog.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+/// constraint check methods of MPCSolver
+enum CheckStrategy{
+	DENSE_CHECK,				///< all rows of AiZ, the bounds are evaluated in the same loop
+	SKIP_CHECK					///< skip constraints method with C0, C1 and tauk
+};
+
+/// state of the background load of MPCSolver::swapProblemData
+enum SwapState{
+	SWAP_IDLE,					///< no problem is waiting, the last one (if any) is in use
+	SWAP_LOADING,				///< the problem is loaded and validated in the background
+	SWAP_READY,					///< the problem is used from the next call to solve
+	SWAP_FAILED					///< the problem could not be loaded, the current problem is kept
+};
+
+/// configuration of the constraint check of MPCSolver
+struct CheckTuning{
+	CheckStrategy	strategy;		///< constraint check method
+	int_t			kernelWidth;	///< number of rows processed together in the dense check
+	int_t			threads;		///< number of threads of the constraint check
+	real_t			time;			///< mean time of one solve during calibration in microseconds
+	bool			calibrated;		///< true if the configuration was measured or read from a tuning file
+};
 /*! \class MPCSolver
  * \brief This class is used to solve the QP problems encountered in parameterized 
  * model predictive control (pdMPC).
@@ -11,10 +40,16 @@ public:
 	/*!
 	 * Constructor to implement pdMPC solver with MATLAB interface
 	 * \param dir contains the address of the directory with required matrices to solve the pdMPC problem
-	 * in .txt files.
+	 * in .txt files. The matrices are shared with other solvers using the same directory.
 	 */
 	MPCSolver(std::string dir);
 
+	/*!
+	 * Constructor for shared problem data
+	 * \param data_i contains the matrices of the MPC problem. Only the workspace is allocated by the solver.
+	 */
+	MPCSolver(std::shared_ptr<const ProblemData> data_i);
+
 	/// destructor
 	~MPCSolver(); 
 	
@@ -34,7 +69,150 @@ public:
 
 	/// returns size of control inputs
 	int_t	getNumberOfOutputs() const {return m;}
+
+	/*!
+	 * \brief switch to the matrices of another problem, e.g. another operating point of a gain-scheduled plant
+	 *
+	 * The workspace of the solver is kept, so no memory is allocated. The problem must have the same
+	 * dimensions (see ProblemData::isCompatible). The active set is reset, so the next call to solve
+	 * starts cold.
+	 * \return false if the problem is not compatible, in which case the current problem is kept
+	 */
+	bool	setProblemData(std::shared_ptr<const ProblemData> data_i);
+
+	/*!
+	 * \brief load a problem in a background thread and switch to it at the start of a later solve
+	 *
+	 * The problem is read from dir, e.g. a regenerated MPCmat directory, and validated (files present,
+	 * finite values, compatible with the current problem, matrices of the constraint check in use).
+	 * The next call to solve switches to it as setProblemData does, which only exchanges pointers. 
+	 * The old problem is released by the background thread, so neither loading nor freeing the 
+	 * matrices takes time in the control loop. The directory is always read again, cached instances
+	 * of ProblemData::load are not used.
+	 * \return false if a previous swap is not finished
+	 */
+	bool	swapProblemData(const std::string &dir);
+
+	/// returns the state of the last call to swapProblemData
+	SwapState getSwapState() const {return (SwapState)swapState.load();}
+
+	/// set the number of threads used by the constraint check (see QPSolver::setNumThreads)
+	virtual void	setNumThreads(const int_t nthreads) override;
+
+	/// returns the problem data used by the solver
+	std::shared_ptr<const ProblemData> getProblemData() const {return data;}
+
+	/*!
+	 * \brief select the constraint check method
+	 *
+	 * The default is the method with less variables: the skip method if s<=nz, the dense check otherwise.
+	 * Factored problem data (see ProblemData) always uses the skip method.
+	 * \return false if the matrices of the method are not loaded (see ProblemData), in which case
+	 * the current method is kept
+	 */
+	bool	setCheckStrategy(const CheckStrategy strategy_i);
+
+	/// returns the constraint check method
+	CheckStrategy getCheckStrategy() const {return strategy;}
+
+	/*!
+	 * \brief measure the available constraint check configurations and use the fastest
+	 *
+	 * The configurations are the check method, the kernel width of the dense check and the number 
+	 * of threads (only for problems above the parallel threshold). Each configuration solves the problems for the given states, starting cold, and the fastest 
+	 * of several passes is compared. The skip method is only measured if its matrices are loaded 
+	 * (always for s<=nz, otherwise use ProblemData::load with loadAll). The decision is written to 
+	 * tuning.txt in the problem directory. The active set is reset afterwards.
+	 * \param x_samples contains nsamples representative states (n values each)
+	 * \param nsamples is the number of states
+	 */
+	void	autotune(const real_t *const x_samples, const int_t nsamples);
+
+	/*!
+	 * \brief enable calibration of the constraint check
+	 *
+	 * If the problem directory contains the decision of an earlier calibration it is used. Otherwise
+	 * autotune is called at the first solve with scaled copies of the first state.
+	 */
+	void	setAutoTuning(const bool enable);
+
+	/// returns the configuration of the constraint check, e.g. for logging
+	const CheckTuning& getTuning() const {return tuning;}
+
+	/// get the size of a snapshot in bytes: the state of QPSolver and the last control input
+	virtual int_t	getSnapshotSize() const override;
+
+	/*! \brief copy the dynamic state of the solver to a binary blob (see QPSolver::saveSnapshot)
+	 *
+	 * The last control input is included, because it is kept when the next solve fails.
+	 */
+	virtual void	saveSnapshot(char *const buf) const override;
+
+	/// restore the state and the last control input from a blob written by saveSnapshot
+	virtual bool	restoreSnapshot(const char *const buf, const int_t size) override;
+
+	/*! \brief change the diagonal weights of the states and inputs in the cost function
+	 *
+	 * The cost of the Laguerre parameterisation is H = blkdiag(kron(diag(q),eye(s)), kron(diag(r),eye(s))).
+	 * G = Z'*H*Z, its Cholesky factor, Li, LiTLi and F = Z'*H*C are computed in the calling thread, 
+	 * which may be another thread than the one calling solve. The new matrices are swapped in at the 
+	 * start of the next solve. The active set is kept and its QR decomposition is computed again.
+	 * The shared problem data is not changed.
+	 * \param q contains the n weights of the states
+	 * \param r contains the m weights of the inputs
+	 * \return false if G is not positive definite, in which case the current weights are kept
+	 */
+	bool	setCostWeights(const real_t *const q, const real_t *const r);
+
+	/*! \brief change the bounds of constraint k of Cxu at all time steps
+	 *
+	 * b_l, b_u and the rows of constraint k in lbineq_c and ubineq_c are updated, so both constraint 
+	 * checks remain valid. The bounds are in the scaling of b_l and b_u. The shared problem data is 
+	 * not changed and the active set is kept.
+	 * \param k is the constraint (row of Cxu, 0 to np-1)
+	 * \return false if k is out of range, lb>ub or the rows of AiZ do not follow time_indices
+	 */
+	bool	setConstraintBounds(const int_t k, const real_t lb, const real_t ub);
+
+	/*! \brief change the bounds of constraint k of Cxu at the time steps t_begin to t_end-1
+	 *
+	 * Only the rows of these time steps are updated in lbineq_c and ubineq_c. The estimates of the 
+	 * skip constraints method assume the same bounds at all time steps, so it evaluates the rows of 
+	 * constraint k exactly until its bounds are set for all time steps again.
+	 */
+	bool	setConstraintBounds(const int_t k, const int_t t_begin, const int_t t_end, const real_t lb, const real_t ub);
+
+	/*! \brief append the state of each following call to solve to a binary log (see StateLog)
+	 *
+	 * The log starts with a snapshot of the current solver state, so pMPC_replay solves the recorded
+	 * states from the same active set. A running recording is closed first.
+	 * \param file is the path of the log
+	 * \param outputs also records u, the number of iterations and the exit flag of each solve
+	 * \return false if the file cannot be written
+	 */
+	bool	startRecording(const std::string &file, const bool outputs = true);
+
+	/// close the log of startRecording
+	void	stopRecording();
+
+	/// returns true while the states are recorded
+	bool	isRecording() const {return recorder != 0;}
 private:
+	/// allocate the workspace of the MPC problem
+	void	initializeMPC();
+
+	/// update the problem for x_IC, solve it and compute the control inputs
+	void	solveStep(const real_t *const x_IC);
+
+	/// read the decision of an earlier calibration from the problem directory
+	bool	loadTuning();
+
+	/// write the decision of the calibration to the problem directory
+	void	saveTuning() const;
+
+	/// point to the MPC matrices of data
+	void	setMPCMatrices();
+
 	/*!
 	 * Updates the QP which has to be solved based on the current state of the system.
 	 */
@@ -46,8 +224,55 @@ private:
 	/// to implement skip constraints method
 	void checkConstraints_skip();
 
+	/// bound of constraint idx, the shift AiC(i,:)*x0 = tauk(t)'*C0(k)*x0 is evaluated from w_x0 for factored data
+	virtual real_t getBound(const int_t idx) const override;
+
+	/// row i of AiZ, which is tauk(t)'*C1(k) for factored data
+	virtual void getRow(const int_t i, real_t *const row) const override;
+
+	/// AiZ(i,:)*x = sum_j tauk(t)_j*C1(k*s+j,:)*x for factored data
+	virtual real_t evaluateRow(const int_t i, const real_t *const x) const override;
+
+	/*!
+	 * \brief check the time steps i_begin+1 to i_end with the skip constraints method
+	 *
+	 * \param idx1 is the number of constraint rows before time step i_begin+1
+	 * \param est_lb, est_ub contain the estimated errors of each constraint, they are updated
+	 * \param max_error, max_idx contain the maximum error and its index, they are updated
+	 */
+	void checkSkipSteps(const int_t i_begin, const int_t i_end, int_t idx1, real_t *const est_lb, 
+		real_t *const est_ub, real_t &max_error, int_t &max_idx) const;
+
+	/*!
+	 * \brief check the time steps with the thread pool
+	 *
+	 * Each thread checks a block of time steps and starts with exact errors. The maximum of the 
+	 * blocks is the same as the one of the serial check as long as the estimates are upper bounds 
+	 * of the errors, only more rows are evaluated exactly.
+	 */
+	void checkSkipParallel(real_t &max_error, int_t &max_idx);
+
+	/// count the constraint rows before each time step
+	void computeStepOffsets();
 
-	real_t	*Z,					///< from qr decomposition of Aeq
+	/// swap in the matrices computed by setCostWeights
+	void applyCostWeights();
+
+	/// set the bounds of the rows of constraint k at the time steps t_begin to t_end-1
+	bool setRowBounds(const int_t k, const int_t t_begin, const int_t t_end, const real_t lb, const real_t ub);
+
+	/// free the bounds set by setConstraintBounds
+	void releaseOwnBounds();
+
+	/// background thread of swapProblemData: load, validate, publish and release the old problem
+	void swapWorker(const std::string dir, std::shared_ptr<const ProblemData> current, const bool loadAll);
+
+	/// switch to the problem published by swapWorker
+	void applySwap();
+
+
+	// shared matrices of the problem
+	const real_t	*Z,			///< from qr decomposition of Aeq
 			*C,					///< C = inv(Y)*R*D;: constant for the problem
 			*AiC,				///< AiC = Aineq*C
 			*F,					///< F = Z'*H*C
@@ -55,31 +280,28 @@ private:
 			/// Matrices for checkConstraintsSkip
 			/// Cs = kron(Cons, eye(s)); (Cons is constraint matrix at each time step)
 			*C0,				///< C0	 = Cs*C
-			*C1;				///< C1	 = Cs*Z
-	
-
-
-	const real_t  *x0;				///< initial condition for solving optimization
+			*C1,				///< C1	 = Cs*Z
 
-	real_t 	*u,					///< control input
 			*tauk,				///< tau vector with size t_star*s
 			*b_l,				///< fixed bounds on Cxu for one time step.
 			*b_u,
+			*eta2u,				///< conversion matrix from eta to u: kron(eye(m),tau0d')
+			*norms;				///< norms of tauk^T*(Md-I);	(k from 0 to t_star)
+
+	const int_t		*time_indices;	///< Time based indices of active constraints: list of active 
+									///< constraints at each time step from 0 to t_star
+
+	real_t  *x0;					///< copy of the initial condition of the last solve (parameter of the bounds)
+
+	// workspace
+	real_t 	*u,					///< control input
 			*eta_u,				///< parameter vector for input variables
 								///< eta_z = [eta_x; eta_u];
-			*eta2u,				///< conversion matrix from eta to u: kron(eye(m),tau0d')
 			
-			*temp_nc,			///< temporary variable
-			*temp_nw,			///< temporary variable
-			
-			*lbineq_c,			///< lower bound of inequality constraints			
-			*ubineq_c,			///< upper bound of inequality constraints	
+			*w_x0,				///< w_x0 = C0*x0, computed once per step
 
 			*eta_w,				///< eta_w = kron(Cxu,eye(s))*eta_z;
-			*norm_w,			///< norm of each part of eta_w
-			*norms;				///< norms of tauk^T*(Md-I);	(k from 0 to t_star)
-
-			
+			*norm_w;			///< norm of each part of eta_w
 	
 	int_t	n,					///< number of states
 			m,					///< number of inputs
@@ -88,10 +310,44 @@ private:
 			m_nw;				///< nw = np*s: number of variables in eta_w formulation
 
 	real_t	*est_lbErr,			///< estimates of error
-			*est_ubErr;
+			*est_ubErr,
+			*par_est;			///< estimates of error of each thread of the parallel skip check
+
+	int_t	*stepOffset;		///< number of constraint rows before each time step of the skip check
+
+	int_t	t_star;				///< Number of time steps used in maximal output admissible set
+
+	CheckStrategy strategy;		///< constraint check method
+
+	bool	autoTune;			///< calibrate the constraint check at the first solve
+
+	CheckTuning	tuning;			///< configuration of the constraint check
+
+	real_t	*F_own,				///< F for the weights of setCostWeights (NULL if the shared F is used)
+			*staged_Li,			///< matrices computed by setCostWeights for the next solve
+			*staged_LiTLi,
+			*staged_F;
+
+	real_t	*b_l_own,			///< b_l and b_u set by setConstraintBounds (NULL if the shared bounds are used)
+			*b_u_own;
+
+	bool	*exactCheck;		///< constraints with different bounds at different time steps (NULL if none),
+								///< the skip constraints method evaluates their rows exactly
+
+	std::shared_ptr<const ProblemData>	staged_data;	///< problem of the staged matrices
+
+	std::mutex			retuneMutex;	///< protects the staged matrices and the assignment of data
+	std::atomic<bool>	retunePending;	///< true if staged matrices wait for the next solve
+
+	std::shared_ptr<const ProblemData>	swapData,	///< problem loaded by swapProblemData for the next solve
+										retired;	///< old problem, released by the background thread
+	std::thread				swapThread;		///< background thread of swapProblemData
+	std::mutex				swapMutex;		///< protects swapData and retired
+	std::condition_variable	swapDone;		///< signals the switch (or the destructor) to swapThread
+	std::atomic<int>		swapState;		///< SwapState of the last swap
+	std::atomic<bool>		swapRunning;	///< true until swapThread returns
+	bool					swapAbort;		///< stops swapThread before the switch
 
-	int_t	t_star,				///< Number of time steps used in maximal output admissible set
-			*time_indices;		///< Time based indices of active constraints: list of active 
-								///< constraints at each time step from 0 to t_star
+	StateLog	*recorder;		///< log of startRecording (NULL if the states are not recorded)
 
-};
\ No newline at end of file
+};
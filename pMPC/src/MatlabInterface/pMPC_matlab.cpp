@@ -4,6 +4,8 @@
 #include "../ActiveConstraints.cpp"
 #include "../Rmatrix.cpp"
 #include "../Utils.cpp"
+#include "../ProblemData.cpp"
+#include "../ThreadPool.cpp"
 #include <string>
 #include <vector>
 
@@ -16,11 +18,13 @@
 
 
 // global pointer to ParametrizedMPC objects
+// handles switched to the same directory share the problem data (see ProblemData::load), initialize
+// reads the directory again because MATLAB regenerates problems into the same folder
 static std::vector<MPCSolver*> MPC_instances;
 
 
 int_t allocateMPCProblem(std::string dir){
-    MPC_instances.push_back(new MPCSolver(dir));
+    MPC_instances.push_back(new MPCSolver(ProblemData::load(dir, false, false, true)));
     printf("Initialized handle %i.\n",(MPC_instances.size()-1));
     return (int_t)(MPC_instances.size()-1);     
 }
@@ -88,6 +92,27 @@ void mexFunction( int_t nlhs, mxArray* plhs[], int_t nrhs, const mxArray* prhs[]
         double *u = mxGetPr( plhs[1] );
         MPC_instances[handle]->getControlInputs(u);     
     }
+    else if(strcmp( typeString,"p")==0){
+        // switch the problem of an instance, e.g. to another operating point
+        int_t handle = (uint_t)mxGetScalar( prhs[1] );
+
+        if(!MPC_instances.at(handle)){
+    		myMexErrMsgIdAndTxt("pMPC:NoHandle", "This handle does not exist.");
+            return;     
+    	}
+        if(nrhs<3 || mxIsChar( prhs[2] ) != 1){
+            myMexErrMsgIdAndTxt( "pMPC:ThirdInputType","ERROR (parametrizedMPC): Third input argument must be a string when switching the problem!\n" );
+            return;
+        }
+        char dirString[100];
+        mxGetString( prhs[2],dirString,100);
+
+        if(!MPC_instances[handle]->setProblemData(ProblemData::load(std::string(dirString)))){
+            myMexErrMsgIdAndTxt("pMPC:Incompatible", "The problem has different dimensions.");
+        }
+        nlhs = 1;
+        plhs[0] = mxCreateDoubleScalar(handle);
+    }
     else if(strcmp( typeString,"d")==0){
         int_t handle = (uint_t)mxGetScalar( prhs[1] );
         deleteMPCProblem(handle);
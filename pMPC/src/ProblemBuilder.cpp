@@ -0,0 +1,786 @@
+#include "ProblemBuilder.h"
+#include "LinearProgram.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+namespace {
+	/// number of rows and columns of the blocks of multiply
+	const int_t BLOCK = 64;
+
+	/// C(r0:r1,:) = A(r0:r1,:)*B, blocked over the inner dimension and the columns of B
+	void multiplyRows(const real_t *const A, const real_t *const B, real_t *const C, const int_t r0, const int_t r1,
+		const int_t inner, const int_t cols){
+		std::fill(&C[r0*cols], &C[r1*cols], 0.0);
+		for (int_t kk = 0; kk < inner; kk += BLOCK){
+			const int_t k1 = std::min(kk+BLOCK, inner);
+			for (int_t jj = 0; jj < cols; jj += BLOCK){
+				const int_t j1 = std::min(jj+BLOCK, cols);
+				for (int_t i = r0; i < r1; ++i){
+					real_t *const c = &C[i*cols];
+					for (int_t k = kk; k < k1; ++k){
+						const real_t a = A[i*inner+k];
+						if (a == 0.0){
+							// the constraint and equality matrices are sparse
+							continue;
+						}
+						const real_t *const b = &B[k*cols];
+						for (int_t j = jj; j < j1; ++j){
+							c[j] += a*b[j];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/// C = A*B (rows x inner times inner x cols), the blocks of rows are distributed over the threads of pool
+	void multiply(ThreadPool &pool, const std::vector<real_t> &A, const std::vector<real_t> &B, std::vector<real_t> &C,
+		const int_t rows, const int_t inner, const int_t cols){
+		C.assign(rows*cols, 0.0);
+		if (rows == 0 || inner == 0 || cols == 0){
+			return;
+		}
+		const int_t nblocks = (rows+BLOCK-1)/BLOCK;
+		const int_t nthreads = pool.getNumThreads();
+		pool.run([&](const int_t t){
+			for (int_t b = t; b < nblocks; b += nthreads){
+				multiplyRows(&A[0], &B[0], &C[0], b*BLOCK, std::min((b+1)*BLOCK, rows), inner, cols);
+			}
+		});
+	}
+
+	/// B = A'
+	std::vector<real_t> transpose(const std::vector<real_t> &A, const int_t rows, const int_t cols){
+		std::vector<real_t> B(rows*cols);
+		Utils::MatrixTranspose(&A[0], &B[0], rows, cols);
+		return B;
+	}
+
+	/// C = kron(A,eye(s)) for A with rows x cols
+	std::vector<real_t> kronEye(const real_t *const A, const int_t rows, const int_t cols, const int_t ld, const int_t s){
+		std::vector<real_t> C(rows*s*cols*s, 0.0);
+		for (int_t i = 0; i < rows; ++i){
+			for (int_t j = 0; j < cols; ++j){
+				for (int_t k = 0; k < s; ++k){
+					C[(i*s+k)*cols*s + j*s+k] = A[i*ld+j];
+				}
+			}
+		}
+		return C;
+	}
+
+	/// X = A\B with partial pivoting for A with n x n and B with n x cols, false if A is singular
+	bool solve(std::vector<real_t> A, std::vector<real_t> &X, const int_t n, const int_t cols){
+		for (int_t j = 0; j < n; ++j){
+			int_t piv = j;
+			for (int_t i = j+1; i < n; ++i){
+				if (std::fabs(A[i*n+j]) > std::fabs(A[piv*n+j])){
+					piv = i;
+				}
+			}
+			if (A[piv*n+j] == 0.0){
+				return false;
+			}
+			if (piv != j){
+				std::swap_ranges(&A[j*n], &A[j*n]+n, &A[piv*n]);
+				std::swap_ranges(&X[j*cols], &X[j*cols]+cols, &X[piv*cols]);
+			}
+			for (int_t i = j+1; i < n; ++i){
+				const real_t f = A[i*n+j]/A[j*n+j];
+				for (int_t k = j; k < n; ++k){
+					A[i*n+k] -= f*A[j*n+k];
+				}
+				for (int_t k = 0; k < cols; ++k){
+					X[i*cols+k] -= f*X[j*cols+k];
+				}
+			}
+		}
+		for (int_t j = n-1; j >= 0; --j){
+			for (int_t k = 0; k < cols; ++k){
+				real_t val = X[j*cols+k];
+				for (int_t i = j+1; i < n; ++i){
+					val -= A[j*n+i]*X[i*cols+k];
+				}
+				X[j*cols+k] = val/A[j*n+j];
+			}
+		}
+		return true;
+	}
+
+	/// E = expm(A) for A with n x n: scaling and squaring with the (6,6) Pade approximation
+	std::vector<real_t> expm(const std::vector<real_t> &A, const int_t n){
+		real_t nrm = 0;
+		for (int_t i = 0; i < n; ++i){
+			real_t row = 0;
+			for (int_t j = 0; j < n; ++j){
+				row += std::fabs(A[i*n+j]);
+			}
+			nrm = std::max(nrm, row);
+		}
+		int_t squarings = 0;
+		if (nrm > 0.5){
+			squarings = (int_t)std::ceil(std::log2(nrm/0.5));
+		}
+		std::vector<real_t> As(A), Ak(n*n, 0.0), tmp(n*n), N(n*n, 0.0), D(n*n, 0.0);
+		Utils::ScalarVectorMult(&As[0], std::ldexp(1.0, -squarings), n*n);
+
+		// N = sum c_k*As^k, D = sum (-1)^k*c_k*As^k
+		const int_t q = 6;
+		real_t c = 1.0;
+		for (int_t i = 0; i < n; ++i){
+			Ak[i*n+i] = 1.0;
+		}
+		for (int_t k = 0; k <= q; ++k){
+			if (k > 0){
+				c *= (real_t)(q-k+1)/(real_t)(k*(2*q-k+1));
+				Utils::MatrixMult(&Ak[0], &As[0], &tmp[0], n, n, n);
+				Ak.swap(tmp);
+			}
+			const real_t sgn = (k%2 == 0)?1.0:-1.0;
+			for (int_t i = 0; i < n*n; ++i){
+				N[i] += c*Ak[i];
+				D[i] += sgn*c*Ak[i];
+			}
+		}
+		solve(D, N, n, n);
+
+		for (int_t k = 0; k < squarings; ++k){
+			Utils::MatrixMult(&N[0], &N[0], &tmp[0], n, n, n);
+			N.swap(tmp);
+		}
+		return N;
+	}
+
+	/// solution P of the discrete Lyapunov equation A*P*A' - P + W = 0 (doubling iteration, A stable)
+	std::vector<real_t> dlyap(const std::vector<real_t> &A, const std::vector<real_t> &W, const int_t n){
+		std::vector<real_t> P(W), Ak(A), tmp(n*n), tmp2(n*n), AkT(n*n);
+		for (int_t it = 0; it < 100; ++it){
+			// P = P + Ak*P*Ak', Ak = Ak^2
+			Utils::MatrixTranspose(&Ak[0], &AkT[0], n, n);
+			Utils::MatrixMult(&Ak[0], &P[0], &tmp[0], n, n, n);
+			Utils::MatrixMult(&tmp[0], &AkT[0], &tmp2[0], n, n, n);
+			real_t change = 0, size = 0;
+			for (int_t i = 0; i < n*n; ++i){
+				P[i] += tmp2[i];
+				change = std::max(change, std::fabs(tmp2[i]));
+				size = std::max(size, std::fabs(P[i]));
+			}
+			if (change <= 1e-17*size){
+				break;
+			}
+			Utils::MatrixMult(&Ak[0], &Ak[0], &tmp[0], n, n, n);
+			Ak.swap(tmp);
+		}
+		return P;
+	}
+
+	/*!
+	 * QR decomposition A = Q*R of A with rows x cols with Householder reflections as in LAPACK (and Matlab qr),
+	 * Q is rows x rows and R is rows x cols
+	 */
+	void qr(const std::vector<real_t> &A, std::vector<real_t> &Q, std::vector<real_t> &R, const int_t rows, const int_t cols){
+		R = A;
+		Q.assign(rows*rows, 0.0);
+		for (int_t i = 0; i < rows; ++i){
+			Q[i*rows+i] = 1.0;
+		}
+		std::vector<real_t> v(rows);
+		for (int_t j = 0; j < std::min(rows-1, cols); ++j){
+			real_t xnorm = 0;
+			for (int_t i = j+1; i < rows; ++i){
+				xnorm += R[i*cols+j]*R[i*cols+j];
+			}
+			if (xnorm == 0.0){
+				// H = I
+				continue;
+			}
+			const real_t alpha = R[j*cols+j];
+			const real_t beta = (alpha >= 0)?-std::sqrt(alpha*alpha+xnorm):std::sqrt(alpha*alpha+xnorm);
+			const real_t tau = (beta-alpha)/beta;
+			v[j] = 1.0;
+			for (int_t i = j+1; i < rows; ++i){
+				v[i] = R[i*cols+j]/(alpha-beta);
+			}
+
+			// R = H*R, Q = Q*H with H = I - tau*v*v'
+			for (int_t c = j; c < cols; ++c){
+				real_t val = 0;
+				for (int_t i = j; i < rows; ++i){
+					val += v[i]*R[i*cols+c];
+				}
+				val *= tau;
+				for (int_t i = j; i < rows; ++i){
+					R[i*cols+c] -= val*v[i];
+				}
+			}
+			for (int_t r = 0; r < rows; ++r){
+				real_t val = 0;
+				for (int_t i = j; i < rows; ++i){
+					val += Q[r*rows+i]*v[i];
+				}
+				val *= tau;
+				for (int_t i = j; i < rows; ++i){
+					Q[r*rows+i] -= val*v[i];
+				}
+			}
+		}
+	}
+
+	/// load a vector from dir/name.txt, false if the file does not exist
+	bool loadFile(const std::string &dir, const char *name, std::vector<real_t> &vec){
+		const std::string tmp = dir+"/"+name;
+		if (!Utils::FileExists(tmp.c_str())){
+			return false;
+		}
+		real_t *data;
+		int_t nv;
+		Utils::LoadVec(tmp.c_str(), &data, nv);
+		vec.assign(data, data+nv);
+		delete[] data;
+		return true;
+	}
+
+	bool loadFile(const std::string &dir, const char *name, std::vector<int_t> &vec){
+		const std::string tmp = dir+"/"+name;
+		if (!Utils::FileExists(tmp.c_str())){
+			return false;
+		}
+		int_t *data;
+		int_t nv;
+		Utils::LoadVec(tmp.c_str(), &data, nv);
+		vec.assign(data, data+nv);
+		delete[] data;
+		return true;
+	}
+}
+
+ProblemSpec::ProblemSpec(){
+	n = m = p = 0;
+	s = 9;
+	alpha = 0.7;
+	Ts = 0.02;
+	horizon = 150;
+	maxSize = 0;
+	window = 1;
+	tolMin = 1e-9;
+	tolMax = 1e-5;
+	maxIter = 50;
+}
+
+bool ProblemSpec::load(const std::string &dir){
+	bool continuous = false;
+	if (!loadFile(dir, "A", A) || !loadFile(dir, "B", B)){
+		if (!loadFile(dir, "Ac", A) || !loadFile(dir, "Bc", B)){
+			printf("missing system matrices A and B (or Ac and Bc) in %s\n", dir.c_str());
+			return false;
+		}
+		continuous = true;
+	}
+	std::vector<real_t> basis;
+	if (!loadFile(dir, "Q", Q) || !loadFile(dir, "R", R) || !loadFile(dir, "Cxu", Cxu) ||
+		!loadFile(dir, "b_l", b_l) || !loadFile(dir, "b_u", b_u) || !loadFile(dir, "basis", basis) || basis.size() < 3){
+		printf("missing Q, R, Cxu, b_l, b_u or basis in %s\n", dir.c_str());
+		return false;
+	}
+	alpha = basis[0];
+	s = (int_t)basis[1];
+	Ts = basis[2];
+
+	n = (int_t)std::lround(std::sqrt((real_t)A.size()));
+	m = (n > 0)?(int_t)B.size()/n:0;
+	p = (int_t)b_l.size();
+	if (n == 0 || m == 0 || n*n != (int_t)A.size() || n*m != (int_t)B.size()){
+		printf("the dimensions of A and B do not match\n");
+		return false;
+	}
+
+	loadFile(dir, "x0", x0);
+	loadFile(dir, "time_indices", time_indices);
+	std::vector<real_t> tmp;
+	if (loadFile(dir, "horizon", tmp) && !tmp.empty()){
+		horizon = (int_t)tmp[0];
+	}
+	if (loadFile(dir, "moas", tmp) && !tmp.empty()){
+		maxSize = (int_t)tmp[0];
+		window = (tmp.size() > 1)?std::max((int_t)tmp[1], 1):1;
+	}
+	if (loadFile(dir, "settings", tmp) && tmp.size() >= 3){
+		tolMin = tmp[0];
+		tolMax = tmp[1];
+		maxIter = (int_t)tmp[2];
+	}
+
+	if (continuous){
+		// zero order hold: expm([Ac Bc; 0 0]*Ts) = [A B; 0 I]
+		const int_t nm = n+m;
+		std::vector<real_t> M(nm*nm, 0.0);
+		for (int_t i = 0; i < n; ++i){
+			for (int_t j = 0; j < n; ++j){
+				M[i*nm+j] = A[i*n+j]*Ts;
+			}
+			for (int_t j = 0; j < m; ++j){
+				M[i*nm+n+j] = B[i*m+j]*Ts;
+			}
+		}
+		const std::vector<real_t> E = expm(M, nm);
+		for (int_t i = 0; i < n; ++i){
+			for (int_t j = 0; j < n; ++j){
+				A[i*n+j] = E[i*nm+j];
+			}
+			for (int_t j = 0; j < m; ++j){
+				B[i*m+j] = E[i*nm+n+j];
+			}
+		}
+	}
+	return true;
+}
+
+ProblemBuilder::ProblemBuilder(const ProblemSpec &spec_i, const int_t nthreads_i): spec(spec_i), nthreads(nthreads_i){
+	nv = nz = nc = px = t_star = 0;
+}
+
+bool ProblemBuilder::build(){
+	const int_t n = spec.n, m = spec.m, p = spec.p, s = spec.s;
+	if (n <= 0 || m <= 0 || p <= 0 || (int_t)spec.A.size() != n*n || (int_t)spec.B.size() != n*m ||
+		(int_t)spec.Q.size() != n*n || (int_t)spec.R.size() != m*m || (int_t)spec.Cxu.size() != p*(n+m) ||
+		(int_t)spec.b_l.size() != p || (int_t)spec.b_u.size() != p || (!spec.x0.empty() && (int_t)spec.x0.size() != n)){
+		printf("the dimensions of the problem do not match\n");
+		return false;
+	}
+	if (m*s <= n || spec.alpha <= 0 || spec.Ts <= 0){
+		printf("increase the number of basis functions (s > n/m) and use alpha > 0, Ts > 0\n");
+		return false;
+	}
+
+	nv = (n+m)*s;
+	nz = m*s-n;
+
+	// normalize constraints
+	for (int_t i = 0; i < p; ++i){
+		const real_t nrm = Utils::VectorNorm(&spec.Cxu[i*(n+m)], n+m);
+		if (nrm == 0.0){
+			printf("constraint %d is empty\n", i);
+			return false;
+		}
+		Utils::ScalarVectorMult(&spec.Cxu[i*(n+m)], 1.0/nrm, n+m);
+		spec.b_l[i] /= nrm;
+		spec.b_u[i] /= nrm;
+	}
+
+	// constraints which involve states are at the top of Cxu
+	px = p;
+	for (int_t i = 0; i < p; ++i){
+		bool state = false;
+		for (int_t j = 0; j < n; ++j){
+			state = state || (spec.Cxu[i*(n+m)+j] != 0.0);
+		}
+		if (!state && px == p){
+			px = i;
+		}else if (state && px < p){
+			printf("constraints which involve only input variables must be at the bottom of Cxu\n");
+			return false;
+		}
+	}
+
+	ThreadPool pool(nthreads);
+	if (!buildBasis()){
+		return false;
+	}
+
+	// time steps of the constraints
+	if (!spec.time_indices.empty()){
+		if (spec.time_indices.size()%p != 0){
+			printf("time_indices must have %d columns\n", p);
+			return false;
+		}
+		time_indices = spec.time_indices;
+	}else if (spec.maxSize > 0){
+		if (!computeMOAS(pool)){
+			return false;
+		}
+	}else{
+		time_indices.assign((spec.horizon+1)*p, 1);
+		for (int_t k = 0; k < px; ++k){
+			// state constraints at the initial time are inactive
+			time_indices[k] = -1;
+		}
+	}
+	t_star = (int_t)time_indices.size()/p - 1;
+
+	buildTrajectory();
+	eliminateEqualities();
+
+	std::vector<real_t> Aineq;
+	buildInequalities(Aineq);
+
+	multiply(pool, Aineq, Z, AiZ, nc, nv, nz);
+	multiply(pool, Aineq, C, AiC, nc, nv, n);
+
+	// data of the skip constraints method: eta_w = Cs*eta
+	const std::vector<real_t> Cs = kronEye(&spec.Cxu[0], p, n+m, n+m, s);
+	multiply(pool, Cs, C, C0, p*s, nv, n);
+	multiply(pool, Cs, Z, C1, p*s, nv, nz);
+
+	// u(0) = kron(eye(m),tau0')*eta_u
+	eta2u.assign(m*m*s, 0.0);
+	for (int_t i = 0; i < m; ++i){
+		Utils::VectorCopy(&tau0[0], &eta2u[i*m*s+i*s], s);
+	}
+
+	return buildCost(pool);
+}
+
+bool ProblemBuilder::buildBasis(){
+	const int_t s = spec.s;
+	const real_t alpha = spec.alpha;
+
+	// continuous Laguerre functions: tau0c = sqrt(2*alpha), Mc = -2*alpha*tril(ones(s)) + alpha*eye(s)
+	std::vector<real_t> Mc(s*s, 0.0), tau0c(s, std::sqrt(2*alpha));
+	for (int_t i = 0; i < s; ++i){
+		for (int_t j = 0; j <= i; ++j){
+			Mc[i*s+j] = (i == j)?-alpha:-2*alpha;
+		}
+	}
+	Utils::ScalarVectorMult(&Mc[0], spec.Ts, s*s);
+	std::vector<real_t> Mdc = expm(Mc, s);
+
+	// orthonormalize: P = dlyap(Md,tau0c*tau0c'), T = chol(P), Md = T\(Md*T), tau0 = T\tau0c
+	std::vector<real_t> W(s*s), P, T(s*s), Ti(s*s), tmp(s*s);
+	Utils::MatrixMult(&tau0c[0], &tau0c[0], &W[0], s, 1, s);
+	P = dlyap(Mdc, W, s);
+	if (!Utils::Cholesky(&P[0], &T[0], s)){
+		printf("the basis functions cannot be orthonormalized\n");
+		return false;
+	}
+	Utils::LowerTriangularInverse(&T[0], &Ti[0], s);
+	Md.resize(s*s);
+	tau0.resize(s);
+	Utils::MatrixMult(&Mdc[0], &T[0], &tmp[0], s, s, s);
+	Utils::MatrixMult(&Ti[0], &tmp[0], &Md[0], s, s, s);
+	Utils::MatrixMult(&Ti[0], &tau0c[0], &tau0[0], s, s, 1);
+	return true;
+}
+
+void ProblemBuilder::buildTrajectory(){
+	const int_t s = spec.s;
+
+	// tau(k+1) = Md*tau(k) and the norms of tau(k)'*(Md-I)
+	std::vector<real_t> tmp(s);
+	tauk.resize((t_star+1)*s);
+	norms.resize(t_star+1);
+	std::vector<real_t> MdI(Md);
+	for (int_t i = 0; i < s; ++i){
+		MdI[i*s+i] -= 1.0;
+	}
+	Utils::VectorCopy(&tau0[0], &tauk[0], s);
+	for (int_t k = 0; k <= t_star; ++k){
+		if (k > 0){
+			Utils::MatrixMult(&Md[0], &tauk[(k-1)*s], &tauk[k*s], s, s, 1);
+		}
+		Utils::MatrixMult(&tauk[k*s], &MdI[0], &tmp[0], 1, s, s);
+		norms[k] = Utils::VectorNorm(&tmp[0], s);
+	}
+}
+
+bool ProblemBuilder::computeMOAS(ThreadPool &pool){
+	const int_t n = spec.n, m = spec.m, p = spec.p, s = spec.s, ns = n*s, ms = m*s;
+	const int_t T = spec.maxSize;
+	const int_t nthreads = pool.getNumThreads();
+
+	// eliminate the dynamics: eta_x = Meq*eta_u with (kron(A,eye(s))-kron(eye(n),Md'))*Meq = -kron(B,eye(s))
+	std::vector<real_t> K = kronEye(&spec.A[0], n, n, n, s);
+	for (int_t a = 0; a < n; ++a){
+		for (int_t b = 0; b < s; ++b){
+			for (int_t d = 0; d < s; ++d){
+				K[(a*s+b)*ns+a*s+d] -= Md[d*s+b];
+			}
+		}
+	}
+	std::vector<real_t> Meq = kronEye(&spec.B[0], n, m, m, s);
+	Utils::ScalarVectorMult(&Meq[0], -1.0, ns*ms);
+	if (!solve(K, Meq, ns, ms)){
+		printf("the dynamics cannot be eliminated, change the basis functions\n");
+		return false;
+	}
+
+	// rows kron(CX(k,:),tau(t)')*Meq + kron(CU(k,:),tau(t)') of the constraints of the time steps 0 to maxSize
+	const int_t N = (T+1)*p;
+	std::vector<real_t> tau((T+1)*s), Wx(N*ns, 0.0), rows, lb(N), ub(N);
+	Utils::VectorCopy(&tau0[0], &tau[0], s);
+	for (int_t t = 1; t <= T; ++t){
+		Utils::MatrixMult(&Md[0], &tau[(t-1)*s], &tau[t*s], s, s, 1);
+	}
+	for (int_t t = 0; t <= T; ++t){
+		for (int_t k = 0; k < p; ++k){
+			for (int_t a = 0; a < n; ++a){
+				for (int_t b = 0; b < s; ++b){
+					Wx[(t*p+k)*ns+a*s+b] = spec.Cxu[k*(n+m)+a]*tau[t*s+b];
+				}
+			}
+			lb[t*p+k] = spec.b_l[k];
+			ub[t*p+k] = spec.b_u[k];
+		}
+	}
+	multiply(pool, Wx, Meq, rows, N, ns, ms);
+	for (int_t t = 0; t <= T; ++t){
+		for (int_t k = 0; k < p; ++k){
+			for (int_t a = 0; a < m; ++a){
+				for (int_t b = 0; b < s; ++b){
+					rows[(t*p+k)*ms+a*s+b] += spec.Cxu[k*(n+m)+n+a]*tau[t*s+b];
+				}
+			}
+		}
+	}
+
+	// candidate t is converged if the constraints of the time steps 0 (inputs only) to t-1 keep each constraint
+	// of time step t strictly inside its bounds: 1 converged, 0 not converged, -1 infeasible, -2 failed.
+	// A failed LP (ill conditioned or cycling) makes its candidate not converged as in Matlab/solve_lp.m,
+	// which only increases t_star.
+	const real_t tol = 1e6*std::numeric_limits<real_t>::epsilon();
+	std::vector<LinearProgram> lps(nthreads, LinearProgram(ms));
+	std::vector<std::vector<int_t> > bases(nthreads*2*p);
+	std::vector<real_t> neg(nthreads*ms);
+	std::vector<int_t> result;
+	int_t failed = 0;
+	auto check = [&](const std::vector<int_t> &cand){
+		const int_t ntasks = (int_t)cand.size()*p;
+		result.assign(ntasks, 0);
+		pool.run([&](const int_t th){
+			// each thread takes a contiguous range of (candidate, constraint) tasks, the LPs of a constraint
+			// start from its working set at the previous candidate of the thread
+			LinearProgram &lp = lps[th];
+			std::vector<int_t> *const basis = &bases[th*2*p];
+			real_t *const f = &neg[th*ms];
+			int_t current = -1;
+			for (int_t task = ntasks*th/nthreads; task < ntasks*(th+1)/nthreads; ++task){
+				const int_t t = cand[task/p], k = task%p;
+				if (t != current){
+					lp.setConstraints(&rows[px*ms], &lb[px], &ub[px], t*p-px);
+					current = t;
+				}
+				real_t fmax, fmin;
+				const LPStatus smax = lp.maximize(&rows[(t*p+k)*ms], fmax, &basis[2*k]);
+				Utils::VectorCopy(&rows[(t*p+k)*ms], f, ms);
+				Utils::ScalarVectorMult(f, -1.0, ms);
+				const LPStatus smin = lp.maximize(f, fmin, &basis[2*k+1]);
+				fmin = -fmin;
+
+				if (smax == LP_INFEASIBLE || smin == LP_INFEASIBLE){
+					result[task] = -1;
+				}else if (smax != LP_OPTIMAL || smin != LP_OPTIMAL){
+					result[task] = -2;
+				}else{
+					result[task] = ((std::isinf(ub[k]) || fmax <= ub[k]-tol) &&
+						(std::isinf(lb[k]) || fmin >= lb[k]+tol))?1:0;
+				}
+			}
+		});
+
+		// status of each candidate
+		std::vector<int_t> status(cand.size(), 1);
+		for (int_t task = 0; task < ntasks; ++task){
+			failed += (result[task] == -2)?1:0;
+			status[task/p] = std::min(status[task/p], (result[task] == -2)?0:result[task]);
+		}
+		return status;
+	};
+
+	// check maxSize, then narrow [t_min, t_max] with nthreads candidates at a time
+	int_t t_min = 0, t_max = T;
+	std::vector<int_t> cand(1, T);
+	std::vector<int_t> status = check(cand);
+	bool converged = (status[0] == 1);
+	while (converged && t_max-t_min > spec.window){
+		const int_t ncand = std::min(nthreads, t_max-t_min-1);
+		cand.clear();
+		for (int_t i = 1; i <= ncand; ++i){
+			const int_t t = t_min+i*(t_max-t_min)/(ncand+1);
+			if (cand.empty() || t > cand.back()){
+				cand.push_back(t);
+			}
+		}
+		status = check(cand);
+		if (*std::min_element(status.begin(), status.end()) < 0){
+			break;
+		}
+		for (size_t i = 0; i < cand.size(); ++i){
+			if (status[i] == 1){
+				t_max = cand[i];
+				break;
+			}
+			t_min = cand[i];
+		}
+	}
+
+	if (*std::min_element(status.begin(), status.end()) == -1){
+		printf("the constraints are infeasible, change the basis functions\n");
+		return false;
+	}
+	if (failed > 0){
+		printf("%d linear programs of the MOAS failed, their time steps are treated as not converged\n", failed);
+	}
+
+	// constraints at the time steps 0 to t_max-1, or 0 to maxSize
+	int_t steps = t_max;
+	if (!converged){
+		printf("the MOAS is not found up to %d time steps, t_star = %d is used\n", T, T);
+		steps = T+1;
+	}
+	time_indices.assign(steps*p, 1);
+	for (int_t k = 0; k < px; ++k){
+		// state constraints at the initial time are inactive
+		time_indices[k] = -1;
+	}
+	return true;
+}
+
+void ProblemBuilder::eliminateEqualities(){
+	const int_t n = spec.n, m = spec.m, s = spec.s, ns = n*s;
+	const int_t peq = n+ns;
+
+	// Aeq = [kron(eye(n),tau0') 0; kron(A,eye(s))-kron(eye(n),Md') kron(B,eye(s))]
+	std::vector<real_t> Aeq(peq*nv, 0.0);
+	for (int_t i = 0; i < n; ++i){
+		Utils::VectorCopy(&tau0[0], &Aeq[i*nv+i*s], s);
+	}
+	for (int_t a = 0; a < n; ++a){
+		for (int_t b = 0; b < s; ++b){
+			real_t *const row = &Aeq[(n+a*s+b)*nv];
+			for (int_t c = 0; c < n; ++c){
+				row[c*s+b] += spec.A[a*n+c];
+			}
+			for (int_t d = 0; d < s; ++d){
+				row[a*s+d] -= Md[d*s+b];
+			}
+			for (int_t c = 0; c < m; ++c){
+				row[ns+c*s+b] = spec.B[a*m+c];
+			}
+		}
+	}
+
+	// [Qeq,Req] = qr(Aeq'), Y = Qeq(:,1:peq), Z = Qeq(:,peq+1:end)
+	std::vector<real_t> Qeq, Req;
+	qr(transpose(Aeq, peq, nv), Qeq, Req, nv, peq);
+	std::vector<real_t> Y(nv*peq);
+	Z.resize(nv*nz);
+	for (int_t i = 0; i < nv; ++i){
+		Utils::VectorCopy(&Qeq[i*nv], &Y[i*peq], peq);
+		Utils::VectorCopy(&Qeq[i*nv+peq], &Z[i*nz], nz);
+	}
+
+	// C = Y/(Req')*D with D = [eye(n); 0]: X = Req'\D by forward substitution
+	std::vector<real_t> X(peq*n, 0.0);
+	for (int_t j = 0; j < n; ++j){
+		for (int_t i = 0; i < peq; ++i){
+			real_t val = (i == j)?1.0:0.0;
+			for (int_t k = 0; k < i; ++k){
+				val -= Req[k*peq+i]*X[k*n+j];
+			}
+			X[i*n+j] = val/Req[i*peq+i];
+		}
+	}
+	C.resize(nv*n);
+	Utils::MatrixMult(&Y[0], &X[0], &C[0], nv, peq, n);
+}
+
+void ProblemBuilder::buildInequalities(std::vector<real_t> &Aineq){
+	const int_t n = spec.n, m = spec.m, p = spec.p, s = spec.s, ns = n*s;
+
+	// rows [kron(CX(k,:),tau(i)') kron(CU(k,:),tau(i)')] of the active constraints of each time step
+	Aineq.clear();
+	lbineq.clear();
+	ubineq.clear();
+	for (int_t i = 0; i <= t_star; ++i){
+		const real_t *const tau = &tauk[i*s];
+		for (int_t k = 0; k < p; ++k){
+			if (time_indices[i*p+k] <= 0){
+				continue;
+			}
+			const real_t *const cxu = &spec.Cxu[k*(n+m)];
+			const size_t row = Aineq.size();
+			Aineq.resize(row+nv, 0.0);
+			for (int_t a = 0; a < n; ++a){
+				for (int_t b = 0; b < s; ++b){
+					Aineq[row+a*s+b] = cxu[a]*tau[b];
+				}
+			}
+			for (int_t a = 0; a < m; ++a){
+				for (int_t b = 0; b < s; ++b){
+					Aineq[row+ns+a*s+b] = cxu[n+a]*tau[b];
+				}
+			}
+			lbineq.push_back(spec.b_l[k]);
+			ubineq.push_back(spec.b_u[k]);
+		}
+	}
+	nc = (int_t)lbineq.size();
+}
+
+bool ProblemBuilder::buildCost(ThreadPool &pool){
+	const int_t n = spec.n, m = spec.m, s = spec.s, ns = n*s;
+
+	// H = blkdiag(kron(Q,eye(s)), kron(R,eye(s)))
+	std::vector<real_t> H(nv*nv, 0.0);
+	const std::vector<real_t> HQ = kronEye(&spec.Q[0], n, n, n, s);
+	const std::vector<real_t> HR = kronEye(&spec.R[0], m, m, m, s);
+	for (int_t i = 0; i < ns; ++i){
+		Utils::VectorCopy(&HQ[i*ns], &H[i*nv], ns);
+	}
+	for (int_t i = 0; i < m*s; ++i){
+		Utils::VectorCopy(&HR[i*m*s], &H[(ns+i)*nv+ns], m*s);
+	}
+
+	// G = Z'*H*Z, F = Z'*H*C
+	std::vector<real_t> ZtH, G;
+	multiply(pool, transpose(Z, nv, nz), H, ZtH, nz, nv, nv);
+	multiply(pool, ZtH, Z, G, nz, nv, nz);
+	multiply(pool, ZtH, C, F, nz, nv, n);
+
+	// G = L*L', Li = inv(L)
+	std::vector<real_t> L(nz*nz);
+	if (!Utils::Cholesky(&G[0], &L[0], nz)){
+		printf("the Hessian is not positive definite\n");
+		return false;
+	}
+	Li.resize(nz*nz);
+	Utils::LowerTriangularInverse(&L[0], &Li[0], nz);
+
+	// g = F*x0
+	g.assign(nz, 0.0);
+	if (!spec.x0.empty()){
+		Utils::MatrixMult(&F[0], &spec.x0[0], &g[0], nz, n, 1);
+	}
+	return true;
+}
+
+bool ProblemBuilder::save(const std::string &dir) const{
+	const std::string d = dir+"/";
+	const real_t params[8] = {spec.tolMin, spec.tolMax, (real_t)spec.maxIter, (real_t)nz, (real_t)nc,
+		(real_t)spec.n, (real_t)spec.m, (real_t)spec.s};
+
+	return Utils::SaveVec((d+"params").c_str(), params, 8) &&
+		Utils::SaveVec((d+"AiC").c_str(), &AiC[0], (int_t)AiC.size()) &&
+		Utils::SaveVec((d+"C").c_str(), &C[0], (int_t)C.size()) &&
+		Utils::SaveVec((d+"eta2u").c_str(), &eta2u[0], (int_t)eta2u.size()) &&
+		Utils::SaveVec((d+"F").c_str(), &F[0], (int_t)F.size()) &&
+		Utils::SaveVec((d+"g").c_str(), &g[0], (int_t)g.size()) &&
+		Utils::SaveVec((d+"Z").c_str(), &Z[0], (int_t)Z.size()) &&
+		Utils::SaveVec((d+"Li").c_str(), &Li[0], (int_t)Li.size()) &&
+		Utils::SaveVec((d+"AiZ").c_str(), &AiZ[0], (int_t)AiZ.size()) &&
+		Utils::SaveVec((d+"C0").c_str(), &C0[0], (int_t)C0.size()) &&
+		Utils::SaveVec((d+"C1").c_str(), &C1[0], (int_t)C1.size()) &&
+		Utils::SaveVec((d+"time_indices").c_str(), &time_indices[0], (int_t)time_indices.size()) &&
+		Utils::SaveVec((d+"norms").c_str(), &norms[0], (int_t)norms.size()) &&
+		Utils::SaveVec((d+"tauk").c_str(), &tauk[0], (int_t)tauk.size()) &&
+		Utils::SaveVec((d+"b_l").c_str(), &spec.b_l[0], spec.p) &&
+		Utils::SaveVec((d+"b_u").c_str(), &spec.b_u[0], spec.p) &&
+		Utils::SaveVec((d+"lbineq").c_str(), &lbineq[0], nc) &&
+		Utils::SaveVec((d+"ubineq").c_str(), &ubineq[0], nc) &&
+		Utils::SaveVec((d+"A").c_str(), &spec.A[0], spec.n*spec.n) &&
+		Utils::SaveVec((d+"B").c_str(), &spec.B[0], spec.n*spec.m);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "DefineSettings.h"
+
+class ThreadPool;
+
+/*!
+ * \brief Definition of a parameterized MPC problem: system, cost, constraints and basis functions.
+ *
+ * All matrices are stored row wise. The problem is
+ *	min sum_k x(k)'*Q*x(k) + u(k)'*R*u(k)	s.t. x(k+1) = A*x(k) + B*u(k), b_l <= Cxu*[x(k);u(k)] <= b_u
+ * with u(k) = kron(eye(m),tau(k)')*eta_u, where tau(k) are the discrete Laguerre functions.
+ */
+struct ProblemSpec{
+	/// default settings of generateSolver.m and defineApproximation.m, no system
+	ProblemSpec();
+
+	int_t	n,					///< number of states
+			m,					///< number of inputs
+			p,					///< number of constraints of one time step (rows of Cxu)
+			s,					///< number of basis functions
+			horizon,			///< constraints are imposed at the time steps 0 to horizon (if time_indices is empty and maxSize is 0)
+			maxSize,			///< largest t_star of the MOAS, 0 if the MOAS is not computed
+			window,				///< the search for t_star of the MOAS stops when it is known up to window steps
+			maxIter;			///< maximum number of iterations of the active set method
+
+	real_t	alpha,				///< decay constant of the Laguerre functions
+			Ts,					///< sampling time, used to discretize the basis (and Ac, Bc)
+			tolMin,				///< minimum tolerance of the constraint check
+			tolMax;				///< maximum tolerance of the constraint check
+
+	std::vector<real_t>	A,		///< discrete-time state matrix (n x n)
+						B,		///< discrete-time input matrix (n x m)
+						Q,		///< penalty on the states (n x n)
+						R,		///< penalty on the inputs (m x m)
+						Cxu,	///< constraint matrix on [x;u] (p x (n+m)), constraints on the inputs only at the bottom
+						b_l,	///< lower bounds of the constraints
+						b_u,	///< upper bounds of the constraints
+						x0;		///< initial state, used for g (zero if empty)
+
+	/// active constraints at each time step ((horizon+1) x p, 1 active, -1 or 0 inactive), e.g. from the MOAS
+	std::vector<int_t>	time_indices;
+
+	/*!
+	 * \brief read a specification from a directory of .txt files in the format of Utils::LoadVec
+	 *
+	 * The files are A and B (or Ac and Bc, discretized with a zero order hold), Q, R, Cxu, b_l, b_u
+	 * and basis = [alpha; s; Ts]. Optional files are x0, horizon, time_indices,
+	 * moas = [maxSize; window] and settings = [tolMin; tolMax; maxIter].
+	 * \return false if a file is missing or the dimensions do not match
+	 */
+	bool	load(const std::string &dir);
+};
+
+/*!
+ * \class ProblemBuilder
+ * \brief Computes the matrices of a parameterized MPC problem offline, as Matlab/generateSolver.m.
+ *
+ * The equality constraints (initial condition and dynamics) are eliminated with the QR decomposition
+ * of Aeq', eta = C*x0 + Z*z. The constraints of the time steps selected by time_indices form Aineq.
+ * If time_indices is not given and maxSize is positive, the constraints are imposed up to t_star of the
+ * maximal output admissible set (MOAS), as Matlab/generateMOAS.m: the smallest t_star such that the
+ * constraints of the time steps 0 to t_star-1 imply the constraints of time step t_star for every eta_u.
+ * Each candidate is checked with 2*p linear programs, several candidates are checked at once on the
+ * threads (multisection instead of bisection). The rows of Cxu are normalized. The large products (Aineq*Z, Aineq*C, Cs*Z, Cs*C and Z'*H*Z) use
+ * a cache blocked kernel which runs on a thread pool.
+ */
+class ProblemBuilder{
+public:
+	/*!
+	 * \brief constructor
+	 *
+	 * \param spec_i is the problem
+	 * \param nthreads is the number of threads of the matrix products
+	 */
+	ProblemBuilder(const ProblemSpec &spec_i, const int_t nthreads = 1);
+
+	/*!
+	 * \brief compute all matrices
+	 * \return false if the specification is not consistent or the Hessian is not positive definite
+	 */
+	bool	build();
+
+	/*!
+	 * \brief write the problem to a directory in the format read by ProblemData (and A, B for simulations)
+	 * \return false if a file could not be written
+	 */
+	bool	save(const std::string &dir) const;
+
+	/// returns the number of decision variables
+	int_t	getNumberOfVariables() const {return nz;}
+
+	/// returns the number of inequality constraints
+	int_t	getNumberOfConstraints() const {return nc;}
+
+	/// returns the number of time steps of time_indices minus 1
+	int_t	getTStar() const {return t_star;}
+
+	// results, row wise
+	std::vector<real_t>	Li,		///< inverse of the Cholesky factor of G = Z'*H*Z
+						F,		///< F = Z'*H*C
+						g,		///< g = F*x0
+						AiZ,	///< AiZ = Aineq*Z
+						AiC,	///< AiC = Aineq*C
+						lbineq,	///< lower bounds of Aineq*eta
+						ubineq,	///< upper bounds of Aineq*eta
+						C,		///< eta = C*x0 + Z*z
+						Z,		///< null space of Aeq
+						eta2u,	///< u(0) = eta2u*eta_u
+						C0,		///< C0 = Cs*C, Cs = kron(Cxu,eye(s))
+						C1,		///< C1 = Cs*Z
+						tauk,	///< basis functions tau(k) at the time steps 0 to t_star (column wise)
+						norms,	///< norms of tau(k)'*(Md-I)
+						Md,		///< evolution of the basis functions, tau(k+1) = Md*tau(k)
+						tau0;	///< basis functions at time 0
+
+	std::vector<int_t>	time_indices;	///< active constraints at each time step
+
+private:
+	/// discretize the Laguerre functions and orthonormalize them
+	bool	buildBasis();
+
+	/// tau(k) and the norms for the time steps 0 to t_star
+	void	buildTrajectory();
+
+	/// time_indices of the MOAS, false if the constraints are infeasible
+	bool	computeMOAS(ThreadPool &pool);
+
+	/// eliminate the equality constraints: C and Z
+	void	eliminateEqualities();
+
+	/// Aineq and the bounds of the active constraints
+	void	buildInequalities(std::vector<real_t> &Aineq);
+
+	/// G, Li, F and g
+	bool	buildCost(ThreadPool &pool);
+
+	ProblemSpec	spec;			///< problem with normalized constraints
+
+	int_t	nthreads,			///< threads of the matrix products
+			nv,					///< number of parameters eta = [eta_x; eta_u]
+			nz,					///< number of decision variables
+			nc,					///< number of inequality constraints
+			px,					///< number of constraints which include states
+			t_star;				///< last time step of time_indices
+};
@@ -0,0 +1,405 @@
+#include "ProblemData.h"
+#include "DefineSettings.h"
+#include "Utils.h"
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <sys/stat.h>
+
+namespace {
+	/// load a vector from dir/name.txt
+	const real_t* loadVector(const std::string &dir, const char *name){
+		std::string tmp = dir+"/"+name;
+		real_t *vec;
+		int_t nv;
+		Utils::LoadVec(tmp.c_str(),&vec,nv);
+		return vec;
+	}
+
+	/// copy n values to a new array, NULL if vec is NULL
+	template<class T>
+	const T* copyArray(const T *const vec, const int_t n){
+		if (!vec){
+			return 0;
+		}
+		T *copy = new T[n];
+		std::copy(vec, vec+n, copy);
+		return copy;
+	}
+
+	/// modification times and sizes of the files which change when the directory is regenerated
+	std::vector<long long> fileStamp(const std::string &dir){
+		static const char *const names[] = {"params", "Li", "AiZ"};
+		std::vector<long long> stamp;
+		for (int_t i = 0; i < 3; ++i){
+			struct stat st;
+			if (stat((dir+"/"+names[i]+".txt").c_str(), &st) == 0){
+				stamp.push_back((long long)st.st_mtime);
+				stamp.push_back((long long)st.st_size);
+			}else{
+				stamp.push_back(-1);
+				stamp.push_back(-1);
+			}
+		}
+		return stamp;
+	}
+
+	/// true if the n entries of vec are finite, infinite entries are accepted if allowInf
+	bool finiteValues(const real_t *const vec, const int_t n, const bool allowInf = false){
+		if (!vec){
+			return true;
+		}
+		for (int_t i = 0; i < n; ++i){
+			if (std::isnan(vec[i]) || (!allowInf && std::isinf(vec[i]))){
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+ProblemData::ProblemData(std::string dir_i, const bool loadAll, const bool factored): dir(dir_i){
+	std::string tmp;
+	int_t tmp2;				// contains the size of the loaded matrix or vector
+
+	// Load basic paramters
+	int_t nparams;
+	{
+		tmp = dir+"/params";
+		real_t *tmpvec;
+
+		Utils::LoadVec(tmp.c_str(),&tmpvec,nparams);
+
+		tolMin = tmpvec[0];
+		tolMax = tmpvec[1];
+		MAXITER = (int_t)tmpvec[2];
+		nz = (int_t)tmpvec[3];
+		nc = (int_t)tmpvec[4];
+
+		n = (nparams>7)?(int_t)tmpvec[5]:0;
+		m = (nparams>7)?(int_t)tmpvec[6]:0;
+		s = (nparams>7)?(int_t)tmpvec[7]:0;
+
+		delete [] tmpvec;
+	}
+
+	// the rows of a reduced problem (pMPC_reduce) are not generated from the factors
+	row_map = 0;
+	tmp = dir+"/row_map";
+	if (Utils::FileExists(tmp.c_str())){
+		int_t *tmpvec;
+		Utils::LoadVec(tmp.c_str(),&tmpvec,tmp2);
+		row_map = tmpvec;
+		assert(tmp2 == nc);
+	}
+
+	// Load QP data
+	AiZ = (factored && hasMPCData() && !row_map)?0:loadVector(dir,"AiZ");
+	Li = loadVector(dir,"Li");
+	g = loadVector(dir,"g");
+	lbineq = loadVector(dir,"lbineq");
+	ubineq = loadVector(dir,"ubineq");
+	computeLiTLi();
+
+	AiC = C = Z = F = eta2u = C0 = C1 = tauk = norms = b_l = b_u = 0;
+	time_indices = row_step = row_constraint = 0;
+	np = t_star = nsteps = 0;
+
+	if (!hasMPCData()){
+		return;
+	}
+
+	// Load MPC data
+	AiC = AiZ?loadVector(dir,"AiC"):0;
+	C = loadVector(dir,"C");
+	eta2u = loadVector(dir,"eta2u");
+	Z = loadVector(dir,"Z");
+	F = loadVector(dir,"F");
+
+	// structure of the constraints at each time step (small, needed to update the bounds)
+	int_t ntime;
+	{
+		real_t *tmpvec;
+		tmp = dir+"/b_l";
+		Utils::LoadVec(tmp.c_str(),&tmpvec,tmp2);
+		b_l = tmpvec;
+		np = tmp2;
+	}
+	{
+		int_t *tmpvec;
+		tmp = dir+"/time_indices";
+		Utils::LoadVec(tmp.c_str(),&tmpvec,ntime);
+		time_indices = tmpvec;
+	}
+	b_u = loadVector(dir,"b_u");
+	nsteps = ntime/np;
+	computeRowMap(nsteps);
+
+	if ((s>nz && !loadAll && AiZ) || row_map){
+		// the dense check is used
+		return;
+	}
+
+	// Load the data of the skip constraints method
+	C0 = loadVector(dir,"C0");
+	C1 = loadVector(dir,"C1");
+
+	int_t ntauk, nnorms;
+	{
+		real_t *tmpvec;
+		tmp = dir+"/tauk";
+		Utils::LoadVec(tmp.c_str(),&tmpvec,ntauk);
+		tauk = tmpvec;
+
+		tmp = dir+"/norms";
+		Utils::LoadVec(tmp.c_str(),&tmpvec,nnorms);
+		norms = tmpvec;
+	}
+
+	// time step 0 is checked separately: the steps 1 to t_star need the columns 1 to t_star of 
+	// tauk, the rows 1 to t_star of time_indices and the first t_star norms
+	t_star = static_cast<int_t>(ntauk/s) - 1;
+	t_star = std::min(t_star, static_cast<int_t>(ntime/np) - 1);
+	t_star = std::min(t_star, nnorms);
+
+	if (!AiZ && (!hasRowMap() || nc==0 || (row_step[nc-1]+1)*s > ntauk)){
+		// the rows cannot be generated from the factors
+		AiZ = loadVector(dir,"AiZ");
+		AiC = loadVector(dir,"AiC");
+	}
+}
+
+void ProblemData::computeRowMap(const int_t ntime){
+	// the rows of AiZ are ordered as in the skip constraints method: the input constraints at t=0
+	// (the last m constraints of a time step), then the constraints with time_indices>0 at t>0
+	int_t nrows = (np >= m)?m:0;
+	for (int_t t = 1; t < ntime; ++t){
+		for (int_t k = 0; k < np; ++k){
+			nrows += (time_indices[t*np+k] > 0)?1:0;
+		}
+	}
+	int_t *step = new int_t[nrows];
+	int_t *constraint = new int_t[nrows];
+	int_t row = 0;
+	for (int_t k = np-m; k < np && row < nrows; ++k, ++row){
+		step[row] = 0;
+		constraint[row] = k;
+	}
+	for (int_t t = 1; t < ntime; ++t){
+		for (int_t k = 0; k < np; ++k){
+			if (time_indices[t*np+k] > 0){
+				step[row] = t;
+				constraint[row] = k;
+				++row;
+			}
+		}
+	}
+
+	// rows of a reduced problem: original rows row_map[i]
+	bool valid = (np >= m) && (nrows >= nc);
+	if (row_map && np >= m){
+		int_t *step_r = new int_t[nc];
+		int_t *constraint_r = new int_t[nc];
+		valid = true;
+		for (int_t i = 0; i < nc && valid; ++i){
+			valid = (row_map[i] >= 0 && row_map[i] < nrows);
+			if (valid){
+				step_r[i] = step[row_map[i]];
+				constraint_r[i] = constraint[row_map[i]];
+			}
+		}
+		std::swap(step, step_r);
+		std::swap(constraint, constraint_r);
+		delete[] step_r;
+		delete[] constraint_r;
+	}
+
+	if (!valid){
+		// the rows do not follow time_indices
+		delete[] step;
+		delete[] constraint;
+		return;
+	}
+	row_step = step;
+	row_constraint = constraint;
+}
+
+ProblemData::ProblemData(const real_t*const Li_i, const real_t*const g_i, const real_t*const Aineq_i,
+	const real_t*const lbineq_i, const real_t*const ubineq_i, const int_t nz_i, const int_t nc_i,
+	const real_t tolMin_i, const real_t tolMax_i, const int_t MAXITER_i)
+{
+	// get parameters
+	nz = nz_i;
+	nc = nc_i;
+	tolMin = tolMin_i;
+	tolMax = tolMax_i;
+	MAXITER = MAXITER_i;
+	n = m = s = np = t_star = nsteps = 0;
+
+	// Copy matrices
+	real_t *tmp;
+	tmp = new real_t[nz*nz];
+	Utils::VectorCopy(Li_i, tmp, nz*nz);
+	Li = tmp;
+
+	tmp = new real_t[nz];
+	Utils::VectorCopy(g_i, tmp, nz);
+	g = tmp;
+
+	tmp = new real_t[nz*nc];
+	Utils::VectorCopy(Aineq_i, tmp, nz*nc);
+	AiZ = tmp;
+
+	tmp = new real_t[nc];
+	Utils::VectorCopy(lbineq_i, tmp, nc);
+	lbineq = tmp;
+
+	tmp = new real_t[nc];
+	Utils::VectorCopy(ubineq_i, tmp, nc);
+	ubineq = tmp;
+
+	computeLiTLi();
+
+	AiC = C = Z = F = eta2u = C0 = C1 = tauk = norms = b_l = b_u = 0;
+	time_indices = row_step = row_constraint = row_map = 0;
+}
+
+ProblemData::ProblemData(const ProblemArrays &a){
+	assert(a.n > 0 && a.m > 0 && a.np >= a.m && a.nsteps > 0 && "the arrays do not contain an MPC problem");
+	tolMin = a.tolMin;
+	tolMax = a.tolMax;
+	MAXITER = a.MAXITER;
+	nz = a.nz;
+	nc = a.nc;
+	n = a.n;
+	m = a.m;
+	s = a.s;
+	np = a.np;
+	nsteps = a.nsteps;
+	row_map = 0;
+
+	const int_t nv = (n+m)*s;
+	Li = copyArray(a.Li, nz*nz);
+	g = a.g?copyArray(a.g, nz):new real_t[nz]();
+	lbineq = copyArray(a.lbineq, nc);
+	ubineq = copyArray(a.ubineq, nc);
+	AiZ = copyArray(a.AiZ, nc*nz);
+	AiC = copyArray(a.AiC, nc*n);
+	computeLiTLi();
+
+	C = copyArray(a.C, nv*n);
+	Z = copyArray(a.Z, nv*nz);
+	F = copyArray(a.F, nz*n);
+	eta2u = copyArray(a.eta2u, m*m*s);
+	b_l = copyArray(a.b_l, np);
+	b_u = copyArray(a.b_u, np);
+	time_indices = copyArray(a.time_indices, nsteps*np);
+	computeRowMap(nsteps);
+
+	// matrices of the skip constraints method, as in the constructor for a directory
+	C0 = copyArray(a.C0, np*s*n);
+	C1 = copyArray(a.C1, np*s*nz);
+	tauk = copyArray(a.tauk, a.ntau*s);
+	norms = copyArray(a.norms, a.ntau);
+	t_star = 0;
+	if (C0 && C1 && tauk && norms){
+		t_star = std::min(std::min(a.ntau-1, nsteps-1), a.ntau);
+	}else{
+		delete[] C0;
+		delete[] C1;
+		delete[] tauk;
+		delete[] norms;
+		C0 = C1 = tauk = norms = 0;
+	}
+	assert((AiZ == 0) == (AiC == 0) && "AiZ and AiC must be given together");
+	assert((AiZ || (C0 && hasRowMap() && (nc == 0 || (row_step[nc-1]+1) <= a.ntau))) &&
+		"the rows of AiZ cannot be generated from the factors");
+}
+
+ProblemData::~ProblemData(){
+	delete[] Li;
+	delete[] LiTLi;
+	delete[] g;
+	delete[] AiZ;
+	delete[] lbineq;
+	delete[] ubineq;
+
+	delete[] AiC;
+	delete[] C;
+	delete[] Z;
+	delete[] F;
+	delete[] eta2u;
+	delete[] C0;
+	delete[] C1;
+	delete[] tauk;
+	delete[] norms;
+	delete[] b_l;
+	delete[] b_u;
+	delete[] time_indices;
+	delete[] row_step;
+	delete[] row_constraint;
+	delete[] row_map;
+}
+
+void ProblemData::computeLiTLi(){
+	// construct LiTLi matrix
+	real_t *temp_nznz = new real_t[nz*nz];
+	real_t *tmp = new real_t[nz*nz];
+	Utils::MatrixTranspose(Li, temp_nznz, nz, nz);
+	Utils::MatrixMult(temp_nznz, Li, tmp, nz, nz, nz);
+	LiTLi = tmp;
+	delete[] temp_nznz;
+}
+
+std::shared_ptr<const ProblemData> ProblemData::load(const std::string &dir, const bool loadAll, const bool factored,
+	const bool reload){
+	struct Entry{
+		std::weak_ptr<const ProblemData> data;
+		std::vector<long long> stamp;
+	};
+	static std::map<std::string, Entry> cache;
+	static std::mutex cacheMutex;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	Entry &entry = cache[dir];
+	const std::vector<long long> stamp = fileStamp(dir);
+	std::shared_ptr<const ProblemData> data = entry.data.lock();
+	if (!data || reload || stamp != entry.stamp ||
+		(loadAll && data->hasMPCData() && !data->hasSkipData() && !data->isReduced()) ||
+		(!factored && data->isFactored())){
+		data = std::make_shared<const ProblemData>(dir, loadAll, factored);
+		entry.data = data;
+		entry.stamp = stamp;
+	}
+	return data;
+}
+
+bool ProblemData::isFinite() const{
+	return finiteValues(Li,nz*nz) && finiteValues(g,nz) && finiteValues(AiZ,nc*nz) &&
+		finiteValues(lbineq,nc,true) && finiteValues(ubineq,nc,true) &&
+		finiteValues(AiC,nc*n) && finiteValues(F,nz*n);
+}
+
+size_t ProblemData::getMemorySize() const{
+	const size_t nv = (n+m)*s;
+	size_t reals = 2*nz*nz + nz + 2*nc;
+	reals += (AiZ?nc*nz:0) + (AiC?nc*n:0);
+	if (hasMPCData()){
+		reals += nv*n + nv*nz + nz*n + m*m*s + 2*np;
+	}
+	if (C0){
+		// the solvers use the first t_star+1 time steps of tauk
+		reals += np*s*n + np*s*nz + (t_star+1)*s + t_star;
+	}
+	const size_t ints = (time_indices?nsteps*np:0) + (row_step?2*nc:0) + (row_map?nc:0);
+	return reals*sizeof(real_t) + ints*sizeof(int_t);
+}
+
+bool ProblemData::isCompatible(const ProblemData &other) const{
+	return nz==other.nz && nc==other.nc && n==other.n && m==other.m && s==other.s &&
+		np==other.np && t_star==other.t_star;
+}
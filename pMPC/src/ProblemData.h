@@ -0,0 +1,188 @@
+#pragma once
+#include <string>
+#include <memory>
+#include "DefineSettings.h"
+
+/*!
+ * \brief Matrices of a parameterized MPC problem in memory, in the layout of the files of a problem directory.
+ *
+ * The matrices are stored row wise as written by pMPC_build. AiZ and AiC can be NULL if C0, C1, tauk
+ * and norms are given (the rows are generated from the factors), the factors can be NULL if AiZ and AiC
+ * are given (only the dense check is available). g can be NULL, MPCSolver computes it from x0.
+ */
+struct ProblemArrays{
+	int_t	nz,					///< number of decision variables
+			nc,					///< number of inequality constraints
+			n,					///< number of states
+			m,					///< number of inputs
+			s,					///< number of basis functions
+			np,					///< number of constraints of one time step
+			nsteps,				///< number of time steps of time_indices
+			ntau,				///< number of time steps of tauk and norms
+			MAXITER;			///< maximum number of iterations
+
+	real_t	tolMin,				///< minimum tolerance of the constraint check
+			tolMax;				///< maximum tolerance of the constraint check
+
+	const real_t	*Li,		///< nz x nz
+					*g,			///< nz
+					*AiZ,		///< nc x nz
+					*AiC,		///< nc x n
+					*lbineq,	///< nc
+					*ubineq,	///< nc
+					*C,			///< (n+m)*s x n
+					*Z,			///< (n+m)*s x nz
+					*F,			///< nz x n
+					*eta2u,		///< m x m*s
+					*b_l,		///< np
+					*b_u,		///< np
+					*C0,		///< np*s x n
+					*C1,		///< np*s x nz
+					*tauk,		///< ntau x s
+					*norms;		///< ntau
+
+	const int_t		*time_indices;	///< nsteps x np
+};
+
+/*! \class ProblemData
+ * \brief Read-only matrices of a QP or a parameterized MPC problem.
+ *
+ * The data is loaded once and shared between solver instances through std::shared_ptr, so that
+ * several QPSolver or MPCSolver objects for the same problem only hold their own workspace.
+ * The arrays are not modified after construction.
+ *
+ * For gain-scheduled controllers, one ProblemData object is loaded for each operating point and
+ * MPCSolver::setProblemData switches between them.
+ */
+class ProblemData{
+public:
+	/*!
+	 * \brief load the problem from a directory
+	 *
+	 * \param dir_i contains the address of the directory with the matrices in .txt files. The MPC matrices
+	 * are loaded if the parameter file contains the number of states, inputs and basis functions.
+	 * \param loadAll loads the matrices of both constraint checks of MPCSolver. By default, the matrices
+	 * of the skip constraints method (C0, C1, tauk, norms) are only loaded if MPCSolver uses it (s<=nz).
+	 * \param factored does not load AiZ and AiC of an MPC problem: their rows are tauk(t)'*C1 and
+	 * tauk(t)'*C0 for the time step and constraint of the row, which MPCSolver evaluates on demand.
+	 * The matrices of the skip constraints method are loaded. AiZ and AiC are loaded nevertheless if
+	 * the rows do not follow time_indices or tauk does not cover all time steps (see isFactored).
+	 *
+	 * A problem reduced by pMPC_reduce contains row_map, the original index of each row. Its rows are a
+	 * subset of the original rows in a different order, so it is not factored and the matrices of the
+	 * skip constraints method are not loaded.
+	 */
+	ProblemData(std::string dir_i, const bool loadAll = false, const bool factored = false);
+
+	/*!
+	 * \brief copy the data of a QP
+	 *
+	 * The arguments are the same as for the corresponding QPSolver constructor.
+	 */
+	ProblemData(const real_t*const Li_i, const real_t*const g_i, const real_t*const Aineq_i,
+		const real_t*const lbineq_i, const real_t*const ubineq_i, const int_t nz_i, const int_t nc_i,
+		const real_t tolMin_i, const real_t tolMax_i, const int_t MAXITER_i);
+
+	/*!
+	 * \brief copy the matrices of an MPC problem from memory
+	 *
+	 * The arrays can be released afterwards. The constraint check methods are available as for a
+	 * problem directory loaded with loadAll.
+	 */
+	ProblemData(const ProblemArrays &arrays);
+
+	/// destructor
+	~ProblemData();
+
+	/*!
+	 * \brief load the problem from a directory, or share the instance which is already loaded from it
+	 *
+	 * Instances are cached by directory name as long as a solver uses them. A cached instance with AiZ
+	 * is also returned for factored. The directory is loaded again if the modification time or the size
+	 * of params, Li or AiZ changed, or if reload is set (e.g. the directory was regenerated within the
+	 * resolution of the modification time). Solvers which use the old instance keep it.
+	 */
+	static std::shared_ptr<const ProblemData> load(const std::string &dir, const bool loadAll = false,
+		const bool factored = false, const bool reload = false);
+
+	/// returns true if a solver can switch from this problem to other without changing its workspace
+	bool	isCompatible(const ProblemData &other) const;
+
+	/// returns true if the matrices of the MPC problem are available
+	bool	hasMPCData() const {return n>0;}
+
+	/// returns true if the matrices of the skip constraints method are available
+	bool	hasSkipData() const {return C0!=0;}
+
+	/// returns false if Li, g, AiZ, AiC or F contain NaN or Inf, or the bounds contain NaN
+	bool	isFinite() const;
+
+	/// returns true if AiZ and AiC are not stored, only their factors C1, C0 and tauk
+	bool	isFactored() const {return AiZ==0;}
+
+	/// returns true if the time step and constraint of each row of AiZ are known
+	bool	hasRowMap() const {return row_step!=0;}
+
+	/// returns true if redundant rows were removed offline, see row_map
+	bool	isReduced() const {return row_map!=0;}
+
+	/// returns the index of row i in the original problem
+	int_t	originalRow(const int_t i) const {return row_map?row_map[i]:i;}
+
+	/// returns the number of bytes of the matrices used by the solvers
+	size_t	getMemorySize() const;
+
+	std::string	dir;			///< directory the data was loaded from (empty if it was copied from matrices)
+
+	// parameters
+	real_t	tolMin,				///< minimum tolerance used for checking constraints
+			tolMax;				///< maximum tolerance used for checking constraints
+
+	int_t	MAXITER,			///< Max iterations for Active Set approach
+			nz,					///< number of decision variables in the QP
+			nc,					///< total number of inequality constraints
+			n,					///< number of states (0 for a plain QP)
+			m,					///< number of inputs
+			s,					///< number of basis funcs
+			np,					///< number of constraints for single time step (Cxu)
+			t_star;				///< Number of future time steps checked by the skip constraints method
+
+	// QP data
+	const real_t	*Li,		///< inverse of Cholesky decomposition of G
+					*LiTLi,		///< LiTLi = Li^T * Li
+					*g,			///< linear part of cost function in QP
+					*AiZ,		///< inequality constraints (NULL if factored)
+					*lbineq,	///< lower bound of inequality constraints (lbineq_c for an MPC problem)
+					*ubineq;	///< upper bound of inequality constraints (ubineq_c for an MPC problem)
+
+	// MPC data
+	const real_t	*AiC,		///< AiC = Aineq*C (NULL if factored)
+					*C,			///< C = inv(Y)*R*D;: constant for the problem
+					*Z,			///< from qr decomposition of Aeq
+					*F,			///< F = Z'*H*C
+					*eta2u,		///< conversion matrix from eta to u: kron(eye(m),tau0d')
+					*C0,		///< C0	 = Cs*C
+					*C1,		///< C1	 = Cs*Z
+					*tauk,		///< tau vector with size t_star*s
+					*norms,		///< norms of tauk^T*(Md-I);	(k from 0 to t_star)
+					*b_l,		///< fixed bounds on Cxu for one time step.
+					*b_u;
+
+	const int_t		*time_indices,	///< list of active constraints at each time step from 0 to t_star
+					*row_step,		///< time step of each row of AiZ (NULL if the rows do not follow time_indices)
+					*row_constraint,///< constraint of Cxu of each row of AiZ
+					*row_map;		///< index of each row of AiZ in the original problem (NULL if not reduced)
+
+private:
+	int_t	nsteps;				///< number of time steps of time_indices
+
+	/// compute LiTLi from Li
+	void	computeLiTLi();
+
+	/// compute row_step and row_constraint from time_indices with ntime time steps
+	void	computeRowMap(const int_t ntime);
+
+	// the arrays are shared, copies are not allowed
+	ProblemData(const ProblemData&) = delete;
+	ProblemData& operator=(const ProblemData&) = delete;
+};
@@ -0,0 +1,236 @@
+#include "ProblemReducer.h"
+#include "LinearProgram.h"
+#include "MPCSolver.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <limits>
+#include <fstream>
+#include <algorithm>
+
+namespace {
+	/// relative margin of a redundant row to its bounds, larger than the accuracy of LinearProgram
+	const real_t MARGIN = 1e-8;
+
+	/// number of previous rows whose working sets are kept for the warm start
+	const int_t HISTORY = 4;
+
+	/// copy dir/name.txt to dir_out/name.txt if it exists
+	bool copyFile(const std::string &dir, const std::string &dir_out, const char *name){
+		std::ifstream in((dir+"/"+name+".txt").c_str(), std::ios::binary);
+		if (!in){
+			return true;
+		}
+		std::ofstream out((dir_out+"/"+name+".txt").c_str(), std::ios::binary);
+		out << in.rdbuf();
+		return out.good();
+	}
+}
+
+ProblemReducer::ProblemReducer(const std::string &dir_i, const std::vector<real_t> &xl_i,
+	const std::vector<real_t> &xu_i, const int_t nthreads_i):
+	dir(dir_i), data(ProblemData::load(dir_i)), xl(xl_i), xu(xu_i), nthreads(nthreads_i), iterations(0)
+{
+	redundant.assign(data->nc, 0);
+	activity.assign(data->nc, 0.0);
+}
+
+bool ProblemReducer::isValid() const{
+	return data->hasMPCData() && data->AiZ && data->AiC && (int_t)xl.size() == data->n && (int_t)xu.size() == data->n;
+}
+
+int_t ProblemReducer::getNumberOfRedundant() const{
+	return (int_t)std::count(redundant.begin(), redundant.end(), 1);
+}
+
+bool ProblemReducer::removeRedundant(){
+	const int_t nz = data->nz, nc = data->nc, n = data->n, nv = nz+n;
+
+	// rows [AiZ AiC] of the constraints and the box of the initial states
+	std::vector<real_t> rows((nc+n)*nv, 0.0), lb(nc+n), ub(nc+n);
+	for (int_t i = 0; i < nc; ++i){
+		Utils::VectorCopy(&data->AiZ[i*nz], &rows[i*nv], nz);
+		Utils::VectorCopy(&data->AiC[i*n], &rows[i*nv+nz], n);
+		lb[i] = data->lbineq[i];
+		ub[i] = data->ubineq[i];
+	}
+	for (int_t k = 0; k < n; ++k){
+		rows[(nc+k)*nv+nz+k] = 1.0;
+		lb[nc+k] = xl[k];
+		ub[nc+k] = xu[k];
+	}
+
+	// each thread checks a contiguous range of rows, the LPs start from the working sets of the most similar
+	// of the last HISTORY rows (the rows of consecutive time steps of a constraint alternate with the others)
+	ThreadPool pool(nthreads);
+	const int_t nth = pool.getNumThreads();
+	std::vector<int_t> status(nc, 0), its(nth, 0);
+	pool.run([&](const int_t th){
+		LinearProgram lp(nv);
+		lp.setConstraints(&rows[0], &lb[0], &ub[0], nc+n);
+		std::vector<int_t> basis[2*HISTORY], previous(HISTORY, -1);
+		std::vector<real_t> f(nv);
+		for (int_t i = nc*th/nth; i < nc*(th+1)/nth; ++i){
+			const real_t inf = std::numeric_limits<real_t>::infinity();
+			lp.setBounds(i, -inf, inf);
+
+			int_t h = i%HISTORY, best = -1;
+			real_t similarity = 0;
+			for (int_t j = 0; j < HISTORY; ++j){
+				if (previous[j] >= 0){
+					real_t val;
+					Utils::DotProduct(&rows[i*nv], &rows[previous[j]*nv], nv, val);
+					if (best < 0 || val > similarity){
+						best = j;
+						similarity = val;
+					}
+				}
+			}
+			if (best >= 0 && best != h){
+				basis[2*h] = basis[2*best];
+				basis[2*h+1] = basis[2*best+1];
+			}
+			previous[h] = i;
+
+			real_t fmax, fmin;
+			const LPStatus smax = lp.maximize(&rows[i*nv], fmax, &basis[2*h]);
+			Utils::VectorCopy(&rows[i*nv], &f[0], nv);
+			Utils::ScalarVectorMult(&f[0], -1.0, nv);
+			const LPStatus smin = lp.maximize(&f[0], fmin, &basis[2*h+1]);
+			fmin = -fmin;
+			lp.setBounds(i, lb[i], ub[i]);
+
+			if (smax == LP_INFEASIBLE || smin == LP_INFEASIBLE){
+				status[i] = -1;
+			}else if (smax == LP_OPTIMAL && smin == LP_OPTIMAL &&
+				(std::isinf(ub[i]) || fmax <= ub[i]-MARGIN*(1+std::fabs(ub[i]))) &&
+				(std::isinf(lb[i]) || fmin >= lb[i]+MARGIN*(1+std::fabs(lb[i])))){
+				// a failed LP keeps the row
+				status[i] = 1;
+			}
+		}
+		its[th] = lp.getIterations();
+	});
+
+	for (int_t th = 0; th < nth; ++th){
+		iterations += its[th];
+	}
+	for (int_t i = 0; i < nc; ++i){
+		if (status[i] < 0){
+			printf("the constraints are infeasible for the box of initial states\n");
+			return false;
+		}
+		redundant[i] = (status[i] == 1)?1:0;
+	}
+	return true;
+}
+
+bool ProblemReducer::loadActivity(const std::string &file){
+	if (!Utils::FileExists(file.c_str())){
+		printf("unable to read %s.txt\n", file.c_str());
+		return false;
+	}
+	real_t *counts;
+	int_t ncounts;
+	Utils::LoadVec(file.c_str(), &counts, ncounts);
+	for (int_t i = 0; i < data->nc; ++i){
+		const int_t row = data->originalRow(i);
+		activity[i] = (row < ncounts)?counts[row]:0.0;
+	}
+	delete[] counts;
+	return true;
+}
+
+bool ProblemReducer::recordActivity(const int_t samples, const int_t steps){
+	const int_t n = data->n, m = data->m;
+	if (!Utils::FileExists((dir+"/A").c_str()) || !Utils::FileExists((dir+"/B").c_str())){
+		printf("A and B are needed to record the activity\n");
+		return false;
+	}
+	real_t *A, *B;
+	int_t tmp;
+	Utils::LoadVec((dir+"/A").c_str(), &A, tmp);
+	Utils::LoadVec((dir+"/B").c_str(), &B, tmp);
+
+	MPCSolver solver(dir);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<real_t> uniform(0.0, 1.0);
+	std::vector<real_t> x(n), Ax(n), Bu(n), u(m);
+	for (int_t sample = 0; sample < samples; ++sample){
+		for (int_t k = 0; k < n; ++k){
+			x[k] = xl[k]+uniform(rng)*(xu[k]-xl[k]);
+		}
+		for (int_t step = 0; step < steps; ++step){
+			solver.solve(&x[0]);
+			for (int_t j = 0; j < solver.getActiveSetSize(); ++j){
+				activity[Utils::absolute(solver.getActiveIndex(j))-1] += 1.0;
+			}
+			solver.getControlInputs(&u[0]);
+			Utils::MatrixMult(A, &x[0], &Ax[0], n, n, 1);
+			Utils::MatrixMult(B, &u[0], &Bu[0], n, m, 1);
+			Utils::VectorAdd(&Ax[0], &Bu[0], &x[0], n);
+		}
+	}
+	delete[] A;
+	delete[] B;
+	return true;
+}
+
+bool ProblemReducer::save(const std::string &dir_out) const{
+	const int_t nz = data->nz, nc = data->nc, n = data->n;
+
+	// remaining rows, the most active first
+	std::vector<int_t> order;
+	for (int_t i = 0; i < nc; ++i){
+		if (!redundant[i]){
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [&](const int_t a, const int_t b){
+		return activity[a] > activity[b];
+	});
+	const int_t nr = (int_t)order.size();
+
+	std::vector<real_t> AiZ(nr*nz), AiC(nr*n), lbineq(nr), ubineq(nr);
+	std::vector<int_t> row_map(nr);
+	int_t norig = 0;
+	for (int_t i = 0; i < nc; ++i){
+		norig = std::max(norig, data->originalRow(i)+1);
+	}
+	std::vector<real_t> counts(norig, 0.0);
+	for (int_t i = 0; i < nc; ++i){
+		counts[data->originalRow(i)] = activity[i];
+	}
+	for (int_t i = 0; i < nr; ++i){
+		Utils::VectorCopy(&data->AiZ[order[i]*nz], &AiZ[i*nz], nz);
+		Utils::VectorCopy(&data->AiC[order[i]*n], &AiC[i*n], n);
+		lbineq[i] = data->lbineq[order[i]];
+		ubineq[i] = data->ubineq[order[i]];
+		row_map[i] = data->originalRow(order[i]);
+	}
+
+	// parameters with the new number of constraints
+	real_t *params;
+	int_t nparams;
+	Utils::LoadVec((dir+"/params").c_str(), &params, nparams);
+	params[4] = (real_t)nr;
+	const std::string d = dir_out+"/";
+	bool ok = Utils::SaveVec((d+"params").c_str(), params, nparams);
+	delete[] params;
+
+	// the matrices of the skip constraints method are not used by a reduced problem
+	const char *const copied[] = {"Li", "g", "C", "Z", "F", "eta2u", "b_l", "b_u", "time_indices", "A", "B"};
+	for (size_t i = 0; i < sizeof(copied)/sizeof(copied[0]); ++i){
+		ok = ok && copyFile(dir, dir_out, copied[i]);
+	}
+	return ok &&
+		Utils::SaveVec((d+"AiZ").c_str(), nr?&AiZ[0]:0, nr*nz) &&
+		Utils::SaveVec((d+"AiC").c_str(), nr?&AiC[0]:0, nr*n) &&
+		Utils::SaveVec((d+"lbineq").c_str(), nr?&lbineq[0]:0, nr) &&
+		Utils::SaveVec((d+"ubineq").c_str(), nr?&ubineq[0]:0, nr) &&
+		Utils::SaveVec((d+"row_map").c_str(), nr?&row_map[0]:0, nr) &&
+		Utils::SaveVec((d+"activity").c_str(), &counts[0], norig);
+}
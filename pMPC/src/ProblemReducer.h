@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "DefineSettings.h"
+#include "ProblemData.h"
+
+/*!
+ * \class ProblemReducer
+ * \brief Removes redundant inequality constraints of an MPC problem offline and sorts the others by activity.
+ *
+ * Row i of AiZ is redundant if the other rows keep it strictly inside its bounds for every initial state
+ * in the box xl <= x0 <= xu, which is checked with two linear programs in the variables [z; x0]:
+ *	max/min AiZ(i,:)*z + AiC(i,:)*x0	s.t. lbineq <= AiZ*z + AiC*x0 <= ubineq (except row i), xl <= x0 <= xu
+ * as Matlab/redundant_cons.m. Rows which are strictly inside their bounds on the feasible set can be removed
+ * together, so the linear programs of all rows are independent and run on a thread pool. The QP of the
+ * reduced problem has the same solution for x0 in the box.
+ *
+ * The remaining rows are sorted by the number of times they were active, so the dense constraint check
+ * finds the likely violations first. The reduced problem contains row_map, the original index of each row,
+ * see QPSolver::getOriginalIndex.
+ */
+class ProblemReducer{
+public:
+	/*!
+	 * \brief constructor
+	 *
+	 * \param dir_i is the directory of the problem (as generated by generateSolver.m or pMPC_build)
+	 * \param xl_i, xu_i are the bounds of the initial states
+	 * \param nthreads_i is the number of threads of the linear programs
+	 */
+	ProblemReducer(const std::string &dir_i, const std::vector<real_t> &xl_i, const std::vector<real_t> &xu_i,
+		const int_t nthreads_i = 1);
+
+	/// returns false if the problem has no AiZ and AiC of an MPC problem or the box does not match the states
+	bool	isValid() const;
+
+	/// find the redundant rows, false if the constraints are infeasible for the box
+	bool	removeRedundant();
+
+	/// read the number of times each constraint was active, in the original numbering (format of Utils::LoadVec)
+	bool	loadActivity(const std::string &file);
+
+	/*!
+	 * \brief count the active constraints in closed loop simulations with A and B of the problem
+	 *
+	 * \param samples is the number of initial states drawn uniformly from the box
+	 * \param steps is the number of time steps of each simulation
+	 * \return false if A or B is missing
+	 */
+	bool	recordActivity(const int_t samples, const int_t steps);
+
+	/// write the reduced problem with row_map and the activity (original numbering), and the unchanged matrices
+	bool	save(const std::string &dir_out) const;
+
+	/// returns the number of rows of the problem
+	int_t	getNumberOfRows() const {return data->nc;}
+
+	/// returns the number of redundant rows
+	int_t	getNumberOfRedundant() const;
+
+	/// returns the number of exchanges of all linear programs
+	int_t	getIterations() const {return iterations;}
+
+private:
+	std::string	dir;					///< directory of the problem
+
+	std::shared_ptr<const ProblemData>	data;
+
+	std::vector<real_t>	xl,				///< lower bounds of the initial states
+						xu,				///< upper bounds of the initial states
+						activity;		///< number of times each row was active
+
+	std::vector<char>	redundant;		///< flags of the redundant rows
+
+	int_t	nthreads,					///< threads of the linear programs
+			iterations;					///< exchanges of the linear programs
+};
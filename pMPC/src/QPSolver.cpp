@@ -4,6 +4,7 @@
 
 #include "Utils.h"
 #include "ActiveConstraints.h"
+#include "Trace.h"
 
 #ifdef _WIN32
     #include <direct.h>
@@ -12,8 +13,36 @@
     #include <unistd.h>
 #endif
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <algorithm>
+#include <vector>
+
+namespace {
+	const int_t SNAPSHOT_MAGIC = 0x53504d70;		///< "pMPS" at the start of a snapshot
+	const int_t SNAPSHOT_VERSION = 1;
+	const int_t SNAPSHOT_HEADER = 5;				///< magic, version, nz, nc, nac
+
+	/// copy n values to the blob and advance the position
+	template<typename T>
+	void writeBlob(char *&pos, const T *const val, const int_t n){
+		memcpy(pos, val, n*sizeof(T));
+		pos += n*sizeof(T);
+	}
+
+	/// copy n values from the blob and advance the position
+	template<typename T>
+	void readBlob(const char *&pos, T *const val, const int_t n){
+		memcpy(val, pos, n*sizeof(T));
+		pos += n*sizeof(T);
+	}
+
+	/// size of the snapshot of QPSolver for nac active constraints
+	int_t snapshotSize(const int_t nz, const int_t nac){
+		return (SNAPSHOT_HEADER + nac)*sizeof(int_t) + (1 + nz*nz + (nac*nac+nac)/2 + nz + nac)*sizeof(real_t);
+	}
+}
 
 QPSolver::QPSolver(std::string dir){
 	// Constructor: Load matrices from directory
@@ -29,48 +58,11 @@ QPSolver::QPSolver(std::string dir){
 		// printf ("The current working directory is %s \n", cCurrentPath);
 	}
 
-	std::string tmp;
-
-	// Load basic paramters
-	{
-		tmp = dir+"/params";
-		int_t nparams;
-		real_t *tmpvec;
-		
-		Utils::LoadVec(tmp.c_str(),&tmpvec,nparams);
-		
-		tolMin = tmpvec[0];
-		tolMax = tmpvec[1];
-		
-		// start with minimum tolerance
-		TOL = tolMin;		
-
-		MAXITER = (uint_t)tmpvec[2];
-		iterRelax = (int_t)MAXITER / 2;
-
-		nz = (int_t)tmpvec[3];
-		nc = (int_t)tmpvec[4];
-		delete [] tmpvec;
-	}
-	
-	// Load QP data	
-	int_t tmp2;				// contains the size of the loaded matrix or vector
-
-	tmp=dir+"/AiZ";
-	Utils::LoadVec(tmp.c_str(),&AiZ,tmp2);
-
-	tmp=dir+"/Li";
-	Utils::LoadVec(tmp.c_str(),&Li,tmp2);
-	
-	tmp=dir+"/g";
-	Utils::LoadVec(tmp.c_str(),&g,tmp2);
-	
-	tmp=dir+"/lbineq";
-	Utils::LoadVec(tmp.c_str(),&lbineq,tmp2);
-
-	tmp=dir+"/ubineq";
-	Utils::LoadVec(tmp.c_str(),&ubineq,tmp2);			
+	data = ProblemData::load(dir);
+	initialize();
+}
 
+QPSolver::QPSolver(std::shared_ptr<const ProblemData> data_i): data(data_i){
 	initialize();
 }
 
@@ -85,40 +77,48 @@ QPSolver::QPSolver(const real_t*const Li_i, const real_t*const g_i, const real_t
 		return;
 	}
 
-	// initialize matrices
-	Li = new real_t[nz_i*nz_i];
-	g = new real_t[nz_i];
-	AiZ = new real_t[nz_i*nc_i];
-	lbineq = new real_t[nc_i];
-	ubineq = new real_t[nc_i];
+	data = std::make_shared<const ProblemData>(Li_i, g_i, Aineq_i, lbineq_i, ubineq_i, nz_i, nc_i, 
+		tolMin_i, tolMax_i, MAXITER_i);
+	initialize();
+	iterRelax = iterRelax_i;
+}
 
-	// Copy matrices
-	Utils::VectorCopy(Li_i, Li, nz_i*nz_i);
-	Utils::VectorCopy(g_i, g, nz_i);
-	Utils::VectorCopy(Aineq_i, AiZ, nz_i*nc_i);
-	Utils::VectorCopy(lbineq_i, lbineq, nc_i);
-	Utils::VectorCopy(ubineq_i, ubineq, nc_i);
-	
+void QPSolver::initialize()
+{
 	// get parameters
-	nz = nz_i;
-	nc = nc_i;
-	tolMin = tolMin_i;
-	tolMax = tolMax_i;
-	MAXITER = MAXITER_i;
-	iterRelax = iterRelax_i;
+	nz = data->nz;
+	nc = data->nc;
+	tolMin = data->tolMin;
+	tolMax = data->tolMax;
+	MAXITER = data->MAXITER;
+	iterRelax = MAXITER / 2;
 
 	// start with minimum tolerance
 	TOL = tolMin;
 
-	initialize();
-}
+	// shared matrices
+	Li = data->Li;
+	AiZ = data->AiZ;
+	LiTLi = data->LiTLi;
+	lbineq = data->lbineq;
+	ubineq = data->ubineq;
+
+	// the shared matrices are replaced by setBounds and setHessianFactor
+	Li_own = LiTLi_own = lbineq_own = ubineq_own = 0;
+
+	// fixed bounds
+	Aipar = 0;
+	par = 0;
+	npar = 0;
+
+	// g is changed by MPCSolver
+	g = new real_t[nz];
+	Utils::VectorCopy(data->g, g, nz);
 
-void QPSolver::initialize()
-{
 	z = new real_t[nz]();
 
 	lambda = new real_t[nz]();
-	activeCons = new ActiveConstraints(AiZ, lbineq, ubineq, Li, nz);
+	activeCons = new ActiveConstraints(AiZ, this, this, Li, nz);
 
 	assert(nz <= MAX_VARS && "nz is less than MAX_VARS");
 
@@ -128,17 +128,100 @@ void QPSolver::initialize()
 	z_sol = new real_t[nz];
 	delta = new real_t[nz];
 	a_del = new real_t[nz];
-	LiTLi = new real_t[nz*nz];
 	indices = new int_t[nz + 1];
 
-	// construct LiTLi matrix
+	engine = PRIMAL_ENGINE;
+	dir_d = new real_t[nz];
+	dir_r = new real_t[nz];
+	step_z = new real_t[nz];
+
+	nAddMax = 1;
+	n_viol = 0;
+	checkWidth = 1;
+	pool = 0;
+	parThreshold = 4096;
+	par_err = 0;
+	par_idx = 0;
+	viol_list = new int_t[nz];
+	viol_err = new real_t[nz];
+}
+
+void QPSolver::setQPData(std::shared_ptr<const ProblemData> data_i){
+	assert(data_i->nz == nz && data_i->nc == nc);
+
+	data = data_i;
+	releaseOwnData();
+	Li = data->Li;
+	AiZ = data->AiZ;
+	LiTLi = data->LiTLi;
+	lbineq = data->lbineq;
+	ubineq = data->ubineq;
+	Utils::VectorCopy(data->g, g, nz);
+
+	// the QR decomposition belongs to the old matrices
+	activeCons->setProblemMatrices(AiZ, Li);
+}
+
+void QPSolver::releaseOwnData(){
+	delete[] Li_own;
+	delete[] LiTLi_own;
+	delete[] lbineq_own;
+	delete[] ubineq_own;
+	Li_own = LiTLi_own = lbineq_own = ubineq_own = 0;
+}
+
+void QPSolver::setLinearTerm(const real_t *const g_i){
+	Utils::VectorCopy(g_i, g, nz);
+}
+
+void QPSolver::allocateOwnBounds(){
+	if (!lbineq_own){
+		lbineq_own = new real_t[nc];
+		ubineq_own = new real_t[nc];
+		Utils::VectorCopy(lbineq, lbineq_own, nc);
+		Utils::VectorCopy(ubineq, ubineq_own, nc);
+		lbineq = lbineq_own;
+		ubineq = ubineq_own;
+	}
+}
+
+void QPSolver::setBounds(const real_t *const lbineq_i, const real_t *const ubineq_i){
+	allocateOwnBounds();
+	Utils::VectorCopy(lbineq_i, lbineq_own, nc);
+	Utils::VectorCopy(ubineq_i, ubineq_own, nc);
+
+	activeCons->refreshBounds();
+}
+
+void QPSolver::setHessianFactor(const real_t *const Li_i){
+	// LiTLi = Li^T * Li
 	real_t *temp_nznz = new real_t[nz*nz];
-	Utils::MatrixTranspose(Li, temp_nznz, nz, nz);
-	Utils::MatrixMult(temp_nznz, Li, LiTLi, nz, nz, nz);
+	real_t *LiTLi_i = new real_t[nz*nz];
+	Utils::MatrixTranspose(Li_i, temp_nznz, nz, nz);
+	Utils::MatrixMult(temp_nznz, Li_i, LiTLi_i, nz, nz, nz);
+
+	replaceHessianFactor(Li_i, LiTLi_i);
+
 	delete[] temp_nznz;
+	delete[] LiTLi_i;
+}
+
+void QPSolver::replaceHessianFactor(const real_t *const Li_i, const real_t *const LiTLi_i){
+	if (!Li_own){
+		Li_own = new real_t[nz*nz];
+		LiTLi_own = new real_t[nz*nz];
+	}
+	Utils::VectorCopy(Li_i, Li_own, nz*nz);
+	Utils::VectorCopy(LiTLi_i, LiTLi_own, nz*nz);
+	Li = Li_own;
+	LiTLi = LiTLi_own;
+
+	// the QR decomposition of the active set depends on Li
+	activeCons->setHessianFactor(Li);
 }
 
 QPSolver::~QPSolver(){
+	releaseOwnData();
 	delete[] z;
 	delete[] lambda;
 	delete activeCons;	
@@ -148,22 +231,32 @@ QPSolver::~QPSolver(){
 	delete[] delta;
 	delete[] a_del;
 	delete[] indices;
+	delete[] viol_list;
+	delete[] viol_err;
+	delete[] dir_d;
+	delete[] dir_r;
+	delete[] step_z;
 
-	delete[] AiZ;
-	delete[] Li;
-	delete[] LiTLi;
 	delete[] g;
-	delete[] lbineq;
-	delete[] ubineq;
+
+	delete pool;
+	delete[] par_err;
+	delete[] par_idx;
 }
 
 
 
 void QPSolver::solve(){
+	PMPC_TRACE_SCOPE("QPSolver::solve");
 	
+	if (engine == DUAL_ENGINE) {
+		solveDual();
+		return;
+	}
+
 	iter = 1;
 	exitFlag = 0;
-	bool reRunFlag = true;
+	activeCons->resetUpdateCount();
 	while (iter<MAXITER)
 	{
 		// solve the problem with current active set as equality constraints
@@ -181,7 +274,12 @@ void QPSolver::solve(){
 		checkConstraints();
 		if (viol)
 		{	
-			addConstraint(viol_idx);
+			if (n_viol > 1 && activeCons->getActiveSetSize() + n_viol <= nz) {
+				// several violations and enough room in the active set
+				addConstraintBlock();
+			}else{
+				addConstraint(viol_idx);
+			}
 
 			if (exitFlag < 0) {
 				// relax tolerance for the next run. 
@@ -199,10 +297,126 @@ void QPSolver::solve(){
 		}
 
 		if (iter == iterRelax) {
-			// relax tolerance and try to solve the problem
+			// relax tolerance and continue with the current active set
+			TOL = tolMax;
+		}
+	}
+
+	// maximum iterations reached in activeSet 
+	exitFlag = -3;
+	// simplify problem
+	TOL = tolMax;
+	activeCons->resetActiveSet();
+}
+
+void QPSolver::solveDual(){
+	/* Dual active set method of Goldfarb and Idnani. lambda contains the negative Lagrange 
+	 * multipliers of the active set (lambda<=0 for a dual feasible active set). For each violated 
+	 * constraint p, z moves along step_z and the multipliers along dir_r until either p is 
+	 * satisfied (full step: p is added) or the multiplier of an active constraint reaches zero
+	 * (partial step: the constraint is removed and the step is repeated for p).
+	 */
+	iter = 1;
+	exitFlag = 0;
+	activeCons->resetUpdateCount();
+
+	// start from a dual feasible active set
+	calcLambda();
+	if (Utils::anyPositive(lambda, activeCons->getActiveSetSize())) {
+		activeCons->resetActiveSet();
+	}
+	calc_z();
+	
+	while (iter<MAXITER)
+	{
+		if (iter == iterRelax) {
+			// relax tolerance, the current active set remains dual feasible
+			TOL = tolMax;
+		}
+
+		// check all constraints for violations
+		checkConstraints();
+		if (!viol) {
+			//QP solved
+			TOL = tolMin;			// tighten the tolerance
+			return;
+		}
+
+		const int_t p = viol_idx;
+
+		// a partial step removes one constraint: at most nz+1 steps for p
+		int_t step = 0;
+		for (; step<=nz; ++step) {
+			const int_t nac = activeCons->getActiveSetSize();
+
+			// directions in dual and primal space
+			activeCons->computeDirection(p, dir_d);
+			Utils::VectorCopy(dir_d, dir_r, nac);
+			activeCons->performRSub(dir_r);						// dir_r = R\d1
+			activeCons->nullspaceStep(dir_d, step_z);				// step_z = LiT*Q2*d2
+
+			real_t nrm_d, nrm_d2;
+			Utils::DotProduct(dir_d, dir_d, nz, nrm_d);
+			Utils::DotProduct(&dir_d[nac], &dir_d[nac], nz - nac, nrm_d2);
+
+			// partial step length: first active multiplier which reaches zero
+			real_t t1 = INFVAL;
+			int_t k = -1;
+			for (int_t j = 0; j<nac; ++j) {
+				if (dir_r[j] > EPSVAL && -lambda[j]/dir_r[j] < t1) {
+					t1 = -lambda[j]/dir_r[j];
+					k = j;
+				}
+			}
+
+			// full step length: p becomes active
+			real_t t2 = INFVAL;
+			if (nrm_d2 > EPSVAL*nrm_d) {
+				calculateError(p, z, &t2);
+				t2 = t2/nrm_d2;
+			}
+
+			if (k < 0 && t2 >= INFVAL) {
+				// no step in primal or dual space: QP is infeasible
+				exitFlag = -4;
+				TOL = tolMax;
+				activeCons->resetActiveSet();
+				return;
+			}
+
+			real_t t = (t1<t2)?t1:t2;
+
+			// take step
+			if (t2 < INFVAL) {
+				Utils::VectorAddMultiply(z, 1.0, step_z, -t, z, nz);
+			}
+			for (int_t j = 0; j<nac; ++j) {
+				lambda[j] += t*dir_r[j];
+			}
+
+			if (t2 <= t1) {
+				// full step: add p and recompute the solution for the new active set
+				activeCons->addConstraint(p);
+				calcLambda();
+				calc_z();
+				break;
+			}
+
+			// partial step: remove constraint k
+			activeCons->removeConstraint(k);
+			for (int_t j = k; j<nac-1; ++j) {
+				lambda[j] = lambda[j+1];
+			}
+		}
+
+		if (step > nz) {
+			// Max Iterations Reached for one constraint
+			exitFlag = -2;
 			TOL = tolMax;
-			activeCons->resetActiveSet();			
+			activeCons->resetActiveSet();
+			return;
 		}
+		++iter;
 	}
 
 	// maximum iterations reached in activeSet 
@@ -213,6 +427,7 @@ void QPSolver::solve(){
 }
 
 void QPSolver::calcLambda(){
+	PMPC_TRACE_SCOPE("calcLambda");
 	if (activeCons->getActiveSetSize()>0){
 		
 		// lambda =  (R'*R)\(bineq(active) + AiZ(active,:)*(Li'*Li*g));
@@ -227,6 +442,7 @@ void QPSolver::calcLambda(){
 }
 
 void QPSolver::calc_z(){
+	PMPC_TRACE_SCOPE("calc_z");
 	if (activeCons->getActiveSetSize()==0){
 		// no active constraints: z = -LiTLig;
 		for (int_t i = 0; i<nz; ++i){		
@@ -246,39 +462,140 @@ void QPSolver::calc_z(){
 }
 
 void QPSolver::checkConstraints(){
-	
+	PMPC_TRACE_SCOPE("checkConstraints");
+	assert(AiZ && "the dense check needs the constraint matrix");
+
 	viol_idx = 0;
+	n_viol = 0;
 	real_t max_error = -INFVAL;
-	for (int i=0;i<nc;++i){
-		real_t prod = 0.0;
-		
-		for(int j=0;j<nz;++j){
-			prod += AiZ[i*nz+j]*z[j];
+
+	if (nAddMax > 1) {
+		// keep a list of the most violated constraints
+		for (int i=0;i<nc;++i){
+			real_t prod;
+			Utils::DotProduct(&AiZ[i*nz],z,nz,prod);
+			if (Aipar) {
+				prod += shiftBound(i);
+			}
+
+			// errors
+			real_t	e1 = prod-ubineq[i],
+					e2 = lbineq[i] - prod;
+			
+			if (e1>=e2) {
+				if (e1>TOL) insertViolation(i+1,e1);
+			}else{
+				if (e2>TOL) insertViolation(-i-1,e2);
+			}
 		}
-		
-		// errors
-		real_t	e1 = prod-ubineq[i];
-		
-		if (e1>max_error)
-		{	// update max error
-			viol_idx = i+1;
-			max_error = e1;
+		viol = (n_viol>0);
+		viol_idx = viol?viol_list[0]:0;
+		return;
+	}
+
+	if (isParallel()) {
+		checkRowsParallel(max_error, viol_idx);
+	}else{
+		checkRows(0, nc, max_error, viol_idx);
+	}
+	viol = (max_error>TOL);
+	n_viol = viol?1:0;
+
+}
+
+void QPSolver::checkRows(const int_t begin, const int_t end, real_t &max_error, int_t &max_idx) const{
+	real_t prod[4];
+	int_t i = begin;
+
+	if (checkWidth == 4) {
+		// four rows share the loads of z
+		for (; i+4<=end; i+=4){
+			Utils::DotProduct4(&AiZ[i*nz],z,nz,prod);
+			for (int_t k=0; k<4; ++k){
+				updateMaxError(i+k, prod[k], max_error, max_idx);
+			}
 		}
-		 
-		e1 = lbineq[i] - prod;
-		if (e1>max_error)
-		{	// update max error
-			viol_idx = -i-1;
-			max_error = e1;
+	}
+
+	for (; i<end; ++i){
+		Utils::DotProduct(&AiZ[i*nz],z,nz,prod[0]);
+		updateMaxError(i, prod[0], max_error, max_idx);
+	}
+}
+
+void QPSolver::checkRowsParallel(real_t &max_error, int_t &max_idx){
+	const int_t nthreads = pool->getNumThreads();
+
+	// blocks are multiples of 4 rows, so that all rows except the last ones use the full kernel width
+	const int_t block = ((nc/nthreads + 3)/4)*4;
+
+	pool->run([this, nthreads, block](const int_t t){
+		const int_t begin = std::min(nc, t*block),
+					end = (t == nthreads-1)?nc:std::min(nc, (t+1)*block);
+		real_t err = -INFVAL;
+		int_t idx = 0;
+		checkRows(begin, end, err, idx);
+		par_err[t] = err;
+		par_idx[t] = idx;
+	});
+
+	// reduce in the order of the rows: the first maximum is kept as in the serial check
+	for (int_t t = 0; t<nthreads; ++t) {
+		if (par_err[t] > max_error) {
+			max_error = par_err[t];
+			max_idx = par_idx[t];
 		}
-	}	
-	viol = (max_error>TOL);
+	}
+}
+
+void QPSolver::setNumThreads(const int_t nthreads){
+	if (nthreads == getNumThreads()) {
+		return;
+	}
 
+	delete pool;
+	delete[] par_err;
+	delete[] par_idx;
+	pool = 0;
+	par_err = 0;
+	par_idx = 0;
+
+	if (nthreads > 1) {
+		pool = new ThreadPool(nthreads);
+		par_err = new real_t[nthreads];
+		par_idx = new int_t[nthreads];
+	}
+}
+
+void QPSolver::setCheckKernelWidth(const int_t width){
+	checkWidth = (width == 4)?4:1;
+}
+
+void QPSolver::insertViolation(const int_t idx, const real_t err){
+	if (n_viol == nAddMax && err <= viol_err[n_viol-1]) {
+		// list is full and err is smaller than all listed violations
+		return;
+	}
+
+	// shift smaller violations to the right
+	int_t i = (n_viol < nAddMax)?n_viol++:n_viol-1;
+	while (i > 0 && viol_err[i-1] < err) {
+		viol_err[i] = viol_err[i-1];
+		viol_list[i] = viol_list[i-1];
+		--i;
+	}
+	viol_err[i] = err;
+	viol_list[i] = idx;
+}
+
+void QPSolver::setMaxBlockAdd(const int_t nAddMax_i){
+	nAddMax = std::max(1,std::min(nAddMax_i,nz));
 }
 
 
 
 void QPSolver::activeSetIterations(const int_t extra_idx){
+	PMPC_TRACE_SCOPE("activeSetIterations");
 	/* This is only called in two cases: 
 	 * 1. When the lagrange multiplier for an active cons>0
 	 * 2. When there are nz active constraints and we would like to add one more
@@ -330,11 +647,10 @@ void QPSolver::activeSetIterations(const int_t extra_idx){
 			for(int i = 0; i<inactive.getSize();++i ){			
 				if(inactive.getIndex(i)>0){
 					// upper bound
-					Utils::DotProduct(&AiZ[(inactive.getIndex(i)-1)*nz],delta,nz,a_del[i]);
+					a_del[i] = rowProduct(inactive.getIndex(i)-1,delta);
 				}else{ 
 					// lower bound
-					Utils::DotProduct(&AiZ[(-inactive.getIndex(i)-1)*nz],delta,nz,a_del[i]);
-					a_del[i] = -a_del[i];
+					a_del[i] = -rowProduct(-inactive.getIndex(i)-1,delta);
 				}	
 			}
 			
@@ -383,95 +699,213 @@ void QPSolver::activeSetIterations(const int_t extra_idx){
 }
 
 void QPSolver::addConstraint(const int_t viol_idx){
-	int_t	t_nac = activeCons->getActiveSetSize();					// get the initial active set size
-	
+	PMPC_TRACE_SCOPE("addConstraint");
+	/* The new constraint is added directly if it is linearly independent of the active set.
+	 * Otherwise Li*a = Li*W^T*r and one active constraint has to leave the set. It is chosen 
+	 * by a ratio test on the Lagrange multipliers (the multipliers stay dual feasible when the
+	 * new constraint enters), with ties broken by the smallest constraint index (Bland's rule).
+	 * Every call thus costs at most two updates of the QR decomposition.
+	 */
+	const int_t	t_nac = activeCons->getActiveSetSize();			// get the initial active set size
 	
-	if (t_nac < nz) { // active set is not full
+	activeCons->computeDirection(viol_idx, dir_d);					// d = QT*Li*a
+	real_t nrm_d, nrm_d2;
+	Utils::DotProduct(dir_d, dir_d, nz, nrm_d);
+	Utils::DotProduct(&dir_d[t_nac], &dir_d[t_nac], nz - t_nac, nrm_d2);
+
+	if (nrm_d2 > EPSVAL*nrm_d) { // linearly independent (active set cannot be full)
 		activeCons->addConstraint(viol_idx);						// add constraint
+		return;
 	}
-	
-	// kick out constraints to find new active set
-	int_t	temp_out_idx,											// index of constraint kicked out
-		temp_idx;												// temporary storage of index to be inserted
-	int add_iter = 1;
-	
-	if (t_nac == nz || activeCons->getLD_Flag()){
 
-		// initialize kicking out constraints
-		if (t_nac == nz) {	// for systems with full active set
-			temp_out_idx = activeCons->getActiveIndex(t_nac - 1); ;
-			activeCons->removeConstraint(t_nac - 1);
-			
-			// add the violation
-			activeCons->addConstraint(viol_idx);
-		}else{	// for systems with linearly dependent active set
-			// viol is added already: just kickout the last constraint (not viol)
-			temp_out_idx = activeCons->getActiveIndex(t_nac - 1); ;
-			activeCons->removeConstraint(t_nac - 1);
+	// r = R\d1: representation of the new constraint in terms of the active constraints
+	calcLambda();
+	Utils::VectorCopy(dir_d, dir_r, t_nac);
+	activeCons->performRSub(dir_r);
+
+	// ratio test: min(-lambda/r) for r>0
+	int_t out_idx = -1;
+	real_t ratio_min = INFVAL;
+	for (int_t j = 0; j < t_nac; ++j) {
+		if (dir_r[j] <= EPSVAL) {
+			continue;
+		}
+		real_t ratio = (lambda[j] < 0) ? -lambda[j] / dir_r[j] : 0.0;
+		if (out_idx < 0 || ratio < ratio_min - EPSVAL || (ratio < ratio_min + EPSVAL && 
+			Utils::absolute(activeCons->getActiveIndex(j)) < Utils::absolute(activeCons->getActiveIndex(out_idx)))) {
+			ratio_min = (ratio < ratio_min) ? ratio : ratio_min;
+			out_idx = j;
 		}
+	}
 
+	if (out_idx < 0) {	// violation cannot be removed by changing the active set: infeasible initial conditions
+		exitFlag = -1;
+		return;
+	}
 
-		while(add_iter<t_nac){
+	// exchange constraints
+	activeCons->removeConstraint(out_idx);
+	activeCons->addConstraint(viol_idx);
+}
 
-			if (activeCons->getLD_Flag()) {	// check flag again because constraint removed
-				// skip current iteration if the active set was not updated
-				// kick out the next constraint
-				temp_idx = temp_out_idx;
-				temp_out_idx = activeCons->getActiveIndex(t_nac - 1 - add_iter);
-				activeCons->removeConstraint(t_nac - 1 - add_iter);
-				activeCons->addConstraint(temp_idx);
-				++add_iter;
-				continue;
-			}
 
-			calcLambda();
-			calc_z();
-			real_t err;
-			calculateError(temp_out_idx, z, &err);
-			if(err>TOL){	// kick out the next constraint(starting from last)
-			
-				temp_idx = temp_out_idx;
-				temp_out_idx =  activeCons->getActiveIndex(t_nac-1-add_iter);
-				activeCons->removeConstraint(t_nac-1-add_iter);
-				activeCons->addConstraint(temp_idx);
-
-			}else if(Utils::anyPositive(lambda,t_nac)){
-				// Perform iterations with one extra constraint!!
-				activeSetIterations(temp_out_idx);
-				break;
-			}else{
-				// removed constraint successfully
-				break;
-			}
 
-			
-			++add_iter;
-		}
+void QPSolver::addConstraintBlock(){
+	PMPC_TRACE_SCOPE("addConstraintBlock");
+	int_t	t_nac = activeCons->getActiveSetSize();					// get the initial active set size
+
+	activeCons->addConstraints(viol_list, n_viol);
 
-	// assert(add_iter<t_nac && "No constraint can be removed.");
-		if (add_iter == t_nac) {	// infeasible initial conditions
-			exitFlag = -1;		
+	if (activeCons->getLD_Flag()) {
+		// linearly dependent block: remove it and add the maximum violation only
+		for (int_t i = 0; i < n_viol; ++i) {
+			indices[i] = t_nac + i;
 		}
+		activeCons->removeConstraints(indices, n_viol);
+		addConstraint(viol_idx);
 	}
 }
 
-
-
 void QPSolver::calculateError(const int_t idx,const real_t *const x, real_t *const err) const{
 	if(idx>0){
 		// upper bound
-		Utils::DotProduct(&AiZ[(idx-1)*nz],x,nz,*err);
-		*err -= ubineq[idx-1];
+		*err = rowProduct(idx-1,x);
 	}else{ 
 		// lower bound
-		Utils::DotProduct(&AiZ[(-idx-1)*nz],x,nz,*err);
-		*err = lbineq[-idx-1]-*err;
+		*err = -rowProduct(-idx-1,x);
 	};
+	*err -= getBound(idx);
+}
+
+real_t QPSolver::getBound(const int_t idx) const{
+	// before the first parameter is set (e.g. when a snapshot is restored) the bounds are not shifted,
+	// they are evaluated again when the parameter is set
+	const bool shift = (Aipar && par);
+	if(idx>0){
+		return (shift)?ubineq[idx-1]-shiftBound(idx-1):ubineq[idx-1];
+	}else{
+		return (shift)?shiftBound(-idx-1)-lbineq[-idx-1]:-lbineq[-idx-1];
+	}
+}
 
+void QPSolver::getRow(const int_t i, real_t *const row) const{
+	assert(AiZ && "the constraint matrix is not stored");
+	Utils::VectorCopy(&AiZ[i*nz],row,nz);
+}
+
+real_t QPSolver::evaluateRow(const int_t, const real_t *const) const{
+	assert(false && "the constraint matrix is not stored");
+	return 0;
 }
 
 void QPSolver::getSolutionCopy(real_t *z_out) const {
 	for (int i = 0; i < nz; ++i) {
 		z_out[i] = z[i];
 	}
-}
\ No newline at end of file
+}
+
+int_t QPSolver::getSnapshotSize() const{
+	return snapshotSize(nz, activeCons->getActiveSetSize());
+}
+
+void QPSolver::saveSnapshot(char *const buf) const{
+	const int_t nac = activeCons->getActiveSetSize();
+	const int_t header[SNAPSHOT_HEADER] = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, nz, nc, nac};
+
+	int_t *indices = new int_t[nz];
+	real_t *Q = new real_t[nz*nz];
+	real_t *R = new real_t[(nz*nz+nz)/2];
+	activeCons->getState(indices, Q, R);
+
+	char *pos = buf;
+	writeBlob(pos, header, SNAPSHOT_HEADER);
+	writeBlob(pos, &TOL, 1);
+	writeBlob(pos, indices, nac);
+	writeBlob(pos, Q, nz*nz);
+	writeBlob(pos, R, (nac*nac+nac)/2);
+	writeBlob(pos, z, nz);
+	writeBlob(pos, lambda, nac);
+
+	delete[] indices;
+	delete[] Q;
+	delete[] R;
+}
+
+bool QPSolver::restoreSnapshot(const char *const buf, const int_t size){
+	int_t header[SNAPSHOT_HEADER];
+	if (size < (int_t)sizeof(header)){
+		printf("snapshot is too short.\n");
+		return false;
+	}
+	const char *pos = buf;
+	readBlob(pos, header, SNAPSHOT_HEADER);
+
+	const int_t nac = header[4];
+	if (header[0] != SNAPSHOT_MAGIC || header[1] != SNAPSHOT_VERSION || header[2] != nz || header[3] != nc || 
+		nac < 0 || nac > nz || size != snapshotSize(nz, nac)){
+		printf("snapshot does not belong to a problem with the same dimensions.\n");
+		return false;
+	}
+
+	real_t TOL_i;
+	int_t *indices = new int_t[nz];
+	real_t *Q = new real_t[nz*nz];
+	real_t *R = new real_t[(nz*nz+nz)/2];
+	readBlob(pos, &TOL_i, 1);
+	readBlob(pos, indices, nac);
+	readBlob(pos, Q, nz*nz);
+	readBlob(pos, R, (nac*nac+nac)/2);
+
+	// each constraint row can be active once
+	bool valid = true;
+	for (int_t i = 0; i < nac && valid; ++i){
+		valid = (indices[i] != 0 && Utils::absolute(indices[i]) <= nc);
+		for (int_t j = 0; j < i && valid; ++j){
+			valid = (Utils::absolute(indices[i]) != Utils::absolute(indices[j]));
+		}
+	}
+
+	if (valid){
+		activeCons->setState(nac, indices, Q, R);
+		readBlob(pos, z, nz);
+		readBlob(pos, lambda, nac);
+		TOL = TOL_i;
+	}else{
+		printf("snapshot contains an invalid active set.\n");
+	}
+
+	delete[] indices;
+	delete[] Q;
+	delete[] R;
+	return valid;
+}
+
+bool QPSolver::saveSnapshotFile(const char *const filename) const{
+	std::vector<char> buf(getSnapshotSize());
+	saveSnapshot(buf.data());
+
+	FILE *file;
+	if ((file = fopen(filename, "wb")) == 0){
+		printf("\n\runable to write file %s\n", filename);
+		return false;
+	}
+	const bool ok = (fwrite(buf.data(), 1, buf.size(), file) == buf.size());
+	fclose(file);
+	return ok;
+}
+
+bool QPSolver::restoreSnapshotFile(const char *const filename){
+	FILE *file;
+	if ((file = fopen(filename, "rb")) == 0){
+		printf("\n\runable to read file %s\n", filename);
+		return false;
+	}
+	std::vector<char> buf;
+	char chunk[4096];
+	size_t nread;
+	while ((nread = fread(chunk, 1, sizeof(chunk), file)) > 0){
+		buf.insert(buf.end(), chunk, chunk+nread);
+	}
+	fclose(file);
+	return restoreSnapshot(buf.data(), (int_t)buf.size());
+}
@@ -1,7 +1,16 @@
 #pragma once
 #include <string>
+#include <memory>
 #include "DefineSettings.h"
 #include "ActiveConstraints.h"
+#include "ProblemData.h"
+#include "ThreadPool.h"
+
+/// active set engines which can be used by QPSolver::solve
+enum QPEngine{
+	PRIMAL_ENGINE,				///< primal active set method (default)
+	DUAL_ENGINE					///< dual active set method of Goldfarb and Idnani
+};
 
 /*! \class QPSolver
  * \brief Solve quadratic programming problems using an active set approach.
@@ -10,11 +19,14 @@
  *	min		0.5 z^T G z + g^T z
  *	s.t		lbineq <= AiZ z <= ubineq
  * 
+ * Derived classes can shift the bounds by a parameter: lbineq - Aipar*par <= AiZ z <= ubineq - Aipar*par.
+ * The shifted bounds are not stored, they are evaluated where they are needed.
+ * 
  * The matrix G is specified in terms of the inverse of its Cholesky decomposition (Li):
  * G = LL^T
  * Li =  inv(L)
  */
-class QPSolver{
+class QPSolver: public ConstraintBounds, public ConstraintRows{
 
 public:
 	/*! 
@@ -22,10 +34,17 @@ public:
 	 * 
 	 * Constructor to use the QPSolver object with MATLAB
 	 * \param dir contains the address of the directory with the matrices Li, g, lbineq,
-	 * AiZ, ubineq in .txt files.
+	 * AiZ, ubineq in .txt files. The matrices are shared with other solvers using the same directory.
 	 */
 	QPSolver(std::string dir);
 
+	/*! 
+	 * \brief Constructor for shared problem data
+	 * 
+	 * \param data_i contains the matrices of the QP. Only the workspace is allocated by the solver.
+	 */
+	QPSolver(std::shared_ptr<const ProblemData> data_i);
+
 	/*! 
 	 * \brief Constructor for C++ interface
 	 * 
@@ -52,6 +71,18 @@ public:
 	/// function to solve QP using incremental active set approach
 	void	solve();
 
+	/*! \brief select the active set engine used by solve
+	 *
+	 * The dual engine (Goldfarb-Idnani) does not need a primal feasible start, adds exactly one 
+	 * constraint per iteration and increases the dual objective monotonically. It starts from the 
+	 * current active set when its Lagrange multipliers are dual feasible, and from the unconstrained 
+	 * solution otherwise. setMaxBlockAdd has no effect on the dual engine.
+	 */
+	void	setEngine(const QPEngine engine_i) {engine = engine_i;}
+
+	/// get the active set engine used by solve
+	QPEngine getEngine() const {return engine;}
+
 	/*! \brief get the number of active set iterations
 	 */
 	int_t	getIterNumber() const {return iter;}
@@ -60,21 +91,159 @@ public:
 	 */
 	int_t	getExitFlag() const { return exitFlag; }
 
+	/*! \brief get the number of updates of the QR decomposition in the last call to solve
+	 *
+	 * With the primal engine, adding a violated constraint costs at most two updates (a linearly
+	 * dependent constraint is exchanged with the active constraint chosen by a ratio test), and each 
+	 * iteration of activeSetIterations at most one. With the default block size this bounds the 
+	 * updates per solve by (MAXITER-1)*(MAXITER+2). With the dual engine each added constraint 
+	 * costs at most nz+2 updates, which bounds the updates by (MAXITER-1)*(nz+2).
+	 */
+	int_t	getUpdateCount() const { return activeCons->getUpdateCount(); }
+
 	/*! \brief get the solution to QP
 		\param z_out is the vector into which the solution to QP is copied
 	 */
 	void	getSolutionCopy(real_t *z_out) const;
+
+	/// get the number of active constraints
+	int_t	getActiveSetSize() const { return activeCons->getActiveSetSize(); }
+
+	/*! \brief get an active constraint
+	 *
+	 * \param idx is the position in the active set (0 to getActiveSetSize()-1)
+	 * \return the index of the constraint, row+1 for the upper bound and -(row+1) for the lower bound
+	 */
+	int_t	getActiveIndex(const int_t idx) const { return activeCons->getActiveIndex(idx); }
+
+	/*! \brief convert the index of a constraint to the numbering of the original problem
+	 *
+	 * The rows of a problem reduced offline (ProblemData::row_map) are a subset of the original rows.
+	 * \param idx is an index as returned by getActiveIndex
+	 */
+	int_t	getOriginalIndex(const int_t idx) const {
+		const int_t row = data->originalRow(Utils::absolute(idx)-1)+1;
+		return (idx < 0)?-row:row;
+	}
+
+	/*! \brief set the linear part of the cost function
+	 *
+	 * The active set is kept, so the next solve starts warm. MPCSolver sets g from the state in each solve.
+	 * \param g_i contains nz values
+	 */
+	void	setLinearTerm(const real_t *const g_i);
+
+	/*! \brief set the bounds of the inequality constraints
+	 *
+	 * The bounds are copied into the solver, the shared problem data is not changed. The active set 
+	 * is kept and the bounds of the active constraints are evaluated again. For MPCSolver these are 
+	 * the bounds before the shift by the state, which are used by the dense constraint check.
+	 * \param lbineq_i contains the nc lower bounds
+	 * \param ubineq_i contains the nc upper bounds
+	 */
+	void	setBounds(const real_t *const lbineq_i, const real_t *const ubineq_i);
+
+	/*! \brief set the inverse of the Cholesky decomposition of G
+	 *
+	 * Li and LiTLi are stored in the solver, the shared problem data is not changed. The QR 
+	 * decomposition of the current active set is computed again for the new Li (one update per 
+	 * active constraint), so the next solve starts from the same active set.
+	 * \param Li_i contains the lower triangular nz x nz matrix Li
+	 */
+	void	setHessianFactor(const real_t *const Li_i);
+
+	/*! \brief set the maximum number of violated constraints added to the active set together
+	 *
+	 * The most violated constraints found in one pass of checkConstraints are added with one 
+	 * blocked update of the QR decomposition, as long as the active set has room for them. 
+	 * This reduces the number of iterations on cold starts. The default is 1. 
+	 * \param nAddMax_i is the maximum number of constraints added in one iteration (1 to nz)
+	 */
+	void	setMaxBlockAdd(const int_t nAddMax_i);
+
+	/*! \brief set the number of rows processed together in the dense constraint check
+	 *
+	 * \param width is 1 (one dot product per row) or 4 (four rows share the loads of z)
+	 */
+	void	setCheckKernelWidth(const int_t width);
+
+	/// get the number of rows processed together in the dense constraint check
+	int_t	getCheckKernelWidth() const {return checkWidth;}
+
+	/*! \brief set the number of threads used by the constraint check
+	 *
+	 * The threads are kept in a pool until the number is changed. Each thread checks a contiguous
+	 * block of rows and the results are reduced in the order of the rows, so the parallel check 
+	 * returns the same constraint as the serial one. The list of violations used by setMaxBlockAdd 
+	 * is always built serially.
+	 * \param nthreads is the number of threads including the calling thread (1 for the serial check)
+	 */
+	virtual void	setNumThreads(const int_t nthreads);
+
+	/// get the number of threads used by the constraint check
+	int_t	getNumThreads() const {return pool?pool->getNumThreads():1;}
+
+	/*! \brief set the minimum number of constraints for which the check runs in parallel
+	 *
+	 * Smaller problems are checked serially to avoid the cost of the synchronisation. The default is 4096.
+	 */
+	void	setParallelThreshold(const int_t nc_min) {parThreshold = nc_min;}
+
+	/// returns true if the constraint check of this problem runs in parallel
+	bool	isParallel() const {return pool && nc >= parThreshold;}
+
+	/// returns the bound of constraint idx: the upper bound for idx>0, the negative lower bound for idx<0
+	virtual real_t getBound(const int_t idx) const override;
+
+	/// copy row i of AiZ to row
+	virtual void	getRow(const int_t i, real_t *const row) const override;
+
+	/// get the size of a snapshot of the solver state in bytes (see saveSnapshot)
+	virtual int_t	getSnapshotSize() const;
+
+	/*! \brief copy the dynamic state of the solver to a binary blob
+	 *
+	 * The state is the active set, Q and the packed R of its QR decomposition, z, lambda and the
+	 * current tolerance. A fresh solver of the same problem which restores the blob starts warm,
+	 * e.g. after a restart of the controller process or in a hot standby process. The blob uses 
+	 * the native number format, so it is only restored by a build with the same settings.
+	 * \param buf must hold getSnapshotSize() bytes
+	 */
+	virtual void	saveSnapshot(char *const buf) const;
+
+	/*! \brief restore the dynamic state of the solver from a blob written by saveSnapshot
+	 *
+	 * The bounds of the active constraints are evaluated for the current parameters of the problem.
+	 * \return false if the blob does not belong to a problem with the same dimensions, in which case
+	 * the state is not changed
+	 */
+	virtual bool	restoreSnapshot(const char *const buf, const int_t size);
+
+	/// write a snapshot of the solver state to a binary file, returns false if the file cannot be written
+	bool	saveSnapshotFile(const char *const filename) const;
+
+	/// restore the solver state from a binary file written by saveSnapshotFile
+	bool	restoreSnapshotFile(const char *const filename);
 private:
 	/// perform initialization 
 	void	initialize();
+
+	/// free the matrices set by setBounds and setHessianFactor
+	void	releaseOwnData();
 	/// perform standard active set approach (when lambda>0)
 	void	activeSetIterations(const int_t extra_idx=0);
 
+	/// solve QP using the dual active set method of Goldfarb and Idnani
+	void	solveDual();
+
 	/// calculate Lagrange multipliers for the current active set
 	void	calcLambda();
 	
 	/// add constraint to the active set
 	void	addConstraint(const  int_t viol_idx);
+
+	/// add the constraints in viol_list to the active set with one blocked update
+	void	addConstraintBlock();
 		
 	/// calculate the error for a particular constraint
 	void	calculateError(const int_t idx,const real_t *const x, real_t *const err) const;
@@ -96,23 +265,40 @@ private:
 								///< -1 for infeasible IC (comes from kickout constraint)
 								///< -2 for maxIter in Primal active set method
 								///< -3 for maxIter in solver
+								///< -4 for infeasible QP (detected by the dual active set method)
+
+	QPEngine engine;			///< active set engine used by solve
+
+	real_t	*dir_d,				///< QT*Li*a for the constraint added in the dual method
+			*dir_r,				///< change of the Lagrange multipliers in the dual method
+			*step_z;			///< change of the solution in the dual method
 
 protected:
-	real_t	*Li;				///< inverse of Cholesky decomposition of G
+	std::shared_ptr<const ProblemData> data;	///< matrices of the problem, shared with other solvers
+
+	const real_t	*Li,		///< inverse of Cholesky decomposition of G
+					*AiZ,		///< inequality constraints	
+					*LiTLi,		///< LiTLi = Li^T * Li	
+					*lbineq,	///< lower bound of inequality constraints			
+					*ubineq,	///< upper bound of inequality constraints		
+					*Aipar,		///< shift of the bounds by the parameter (NULL if the bounds are fixed)
+					*par;		///< parameter of the bounds
 	
 	int_t	nc,					///< total number of inequality constraints;
-			nz;					///< number of decision variables in the QP
+			nz,					///< number of decision variables in the QP
+			npar;				///< number of parameters
+
+	real_t	*Li_own,			///< Li set by setHessianFactor (NULL if the shared Li is used)
+			*LiTLi_own,			///< LiTLi of Li_own
+			*lbineq_own,		///< bounds set by setBounds (NULL if the shared bounds are used)
+			*ubineq_own;
 
 	real_t	*z,					///< values of decision variables at each iteration
 			*g,					///< linear part of cost function in QP
-			*AiZ,				///< inequality constraints	
-			*lbineq,			///< lower bound of inequality constraints			
-			*ubineq,			///< upper bound of inequality constraints		
 
 			*temp_nz,			///< temporary variable
 			*temp_nz2,			///< temporary variable
 
-			*LiTLi,				///< LiTLi = Li^T * Li	
 			*lambda,			///< Lagrange multipliers of active set
 		
 			tolMin,				///< minimum tolerance used for checking constraints
@@ -122,6 +308,21 @@ protected:
 	int_t	iterRelax,			///< iteration at which tolerance is relaxed to maxTol
 			viol_idx;			///< index of maximum violation; negative index for lb
 								// add 1 to absolute index because 0 and -0 are same
+
+	int_t	nAddMax,			///< maximum number of violated constraints added in one iteration
+			n_viol,				///< number of violated constraints in viol_list
+			*viol_list;			///< indices of the most violated constraints, in descending order of violation
+
+	real_t	*viol_err;			///< violations of the constraints in viol_list
+
+	int_t	checkWidth;			///< number of rows processed together in the dense constraint check
+
+	ThreadPool	*pool;			///< threads of the constraint check (NULL for the serial check)
+
+	int_t	parThreshold;		///< minimum number of constraints for the parallel check
+
+	real_t	*par_err;			///< maximum error found by each thread
+	int_t	*par_idx;			///< index of the maximum error found by each thread
 	
 	/// class containing active constraint coefficients
 	ActiveConstraints *activeCons;
@@ -131,10 +332,76 @@ protected:
 	/// check constraints of the QP for violations
 	virtual void	checkConstraints();
 
+	/*! \brief check the rows begin to end-1 of the dense constraints
+	 *
+	 * max_error and max_idx are updated if a row has a larger error. The result does not depend on
+	 * the kernel width.
+	 */
+	void	checkRows(const int_t begin, const int_t end, real_t &max_error, int_t &max_idx) const;
+
+	/// check all rows of the dense constraints with the thread pool
+	void	checkRowsParallel(real_t &max_error, int_t &max_idx);
+
+	/// copy the bounds into lbineq_own and ubineq_own, which are used from then on
+	void	allocateOwnBounds();
+
+	/// set Li and LiTLi = Li^T*Li (see setHessianFactor)
+	void	replaceHessianFactor(const real_t *const Li_i, const real_t *const LiTLi_i);
+
+	/// compare the errors of constraint row i, with AiZ(i,:)*z = prod, to max_error
+	void	updateMaxError(const int_t i, real_t prod, real_t &max_error, int_t &max_idx) const{
+		if (Aipar) {
+			// bounds are shifted by Aipar*par
+			prod += shiftBound(i);
+		}
+
+		real_t	e1 = prod-ubineq[i];
+		if (e1>max_error) {
+			max_idx = i+1;
+			max_error = e1;
+		}
+
+		e1 = lbineq[i] - prod;
+		if (e1>max_error) {
+			max_idx = -i-1;
+			max_error = e1;
+		}
+	}
+
+	/// AiZ(i,:)*x, rows which are not stored are evaluated by evaluateRow
+	real_t	rowProduct(const int_t i, const real_t *const x) const{
+		real_t val;
+		if (AiZ){
+			Utils::DotProduct(&AiZ[i*nz],x,nz,val);
+		}else{
+			val = evaluateRow(i,x);
+		}
+		return val;
+	}
+
+	/// AiZ(i,:)*x if AiZ is not stored (see MPCSolver)
+	virtual real_t	evaluateRow(const int_t i, const real_t *const x) const;
+
+	/// shift of the bounds of constraint row i: Aipar(i,:)*par
+	real_t	shiftBound(const int_t i) const{
+		real_t val;
+		Utils::DotProduct(&Aipar[i*npar],par,npar,val);
+		return val;
+	}
+
+	/// insert constraint idx with violation err into the sorted list viol_list
+	void	insertViolation(const int_t idx, const real_t err);
+
 	/*! \brief calculates the solution for the current active set, where the constraints in the active set are 
 	 * considered as equality constraints, and all other constriants are neglected.
 	 */
 	virtual void	calc_z();
 
+	/*! \brief use the matrices of another problem with the same dimensions
+	 *
+	 * g is copied from data_i and the active set is reset.
+	 */
+	void	setQPData(std::shared_ptr<const ProblemData> data_i);
+
 };
 
@@ -1,6 +1,7 @@
 #include "Rmatrix.h"
 #include "Utils.h"
 #include "DefineSettings.h"
+#include "Trace.h"
 #include <cmath>
 
 Rmatrix::Rmatrix(const int_t nz, const int_t *const nac):
@@ -11,6 +12,7 @@ Rmatrix::Rmatrix(const int_t nz, const int_t *const nac):
 	temp_nznz	= new real_t [m_nz*m_nz];
 	m_R			= new real_t [static_cast<int_t>(m_nz*m_nz+m_nz)/2];
 	Gq			= new real_t [m_nz*m_nz];
+	temp_v		= new real_t [m_nz];
 };
 
 Rmatrix::~Rmatrix(){
@@ -19,9 +21,11 @@ Rmatrix::~Rmatrix(){
 	delete[] temp_nznz;
 	delete[] m_R;
 	delete[] Gq;
+	delete[] temp_v;
 
 };
 void Rmatrix::updateR(real_t *const vec1){
+	PMPC_TRACE_SCOPE("updateR");
 
 	for (int i=0; i<m_nz; ++i){
 		// convert Gq into an identity matrix
@@ -48,6 +52,7 @@ void Rmatrix::updateR(real_t *const vec1){
 }
 
 void Rmatrix::downdateR(const int_t idx){
+	PMPC_TRACE_SCOPE("downdateR");
 	
 	// convert Gq into an identity matrix
 	for (int i=0; i<m_nz; ++i){
@@ -65,8 +70,9 @@ void Rmatrix::downdateR(const int_t idx){
 		
 		for(int j=i;j<*m_nac;++j){			// columns affected by givens 
 			int_t k = (j*j + j)/2;
-			m_R[k+i-1] = giv_c*m_R[(j*j + j)/2+i-1] + giv_s*m_R[k+i];					// R[i-1,j]
-			m_R[k+i] = -giv_s/giv_c*m_R[k+i-1] + (giv_c + giv_s*giv_s/giv_c)*m_R[k+i];	// R[i,j]
+			real_t r1 = m_R[k+i-1];
+			m_R[k+i-1] = giv_c*r1 + giv_s*m_R[k+i];				// R[i-1,j]
+			m_R[k+i] = -giv_s*r1 + giv_c*m_R[k+i];				// R[i,j]
 		}
 		
 	}
@@ -85,6 +91,156 @@ void Rmatrix::downdateR(const int_t idx){
 	
 }
 
+void Rmatrix::updateRBlock(real_t *const cols, const int_t k, real_t *const Q){
+	PMPC_TRACE_SCOPE("updateRBlock");
+	// triangularize rows *m_nac.. of the new columns one column at a time
+	for (int_t t=0; t<k; ++t){
+		const int_t p = *m_nac + t;						// diagonal position of column t
+		real_t *const col = &cols[t*m_nz];
+		
+		if (p < m_nz-1){
+			// reflection which zeroes col[p+1:end]
+			Utils::VectorCopy(&col[p],temp_v,m_nz-p);
+			real_t beta = householder(temp_v,m_nz-p,1);
+			col[p] = temp_v[0];
+			temp_v[0] = 1.0;
+			for (int_t i=p+1; i<m_nz; ++i){
+				col[i] = 0.0;
+			}
+			
+			if (beta != 0.0){
+				// apply to remaining new columns
+				for (int_t j=t+1; j<k; ++j){
+					real_t *const colj = &cols[j*m_nz];
+					real_t val;
+					Utils::DotProduct(temp_v,&colj[p],m_nz-p,val);
+					val *= beta;
+					for (int_t i=0; i<m_nz-p; ++i){
+						colj[p+i] -= val*temp_v[i];
+					}
+				}
+				
+				// Qnew = Qold*H
+				householderQUpdate(temp_v,beta,p,m_nz-p,Q);
+			}
+		}
+
+		// add updated column to R
+		for (int_t i = 0; i<p+1; ++i) {
+			m_R[(p*p + p) / 2 + i] = col[i];
+		}
+	}
+}
+
+void Rmatrix::downdateRBlock(const int_t *const idx, const int_t k, real_t *const Q){
+	PMPC_TRACE_SCOPE("downdateRBlock");
+	if (k == 0){
+		return;
+	}
+	const int_t nac_new = *m_nac - k;
+
+	// unpack the remaining columns into temp_nznz (row wise), column j comes from column orig(j) >= j
+	int_t removed = 0;
+	for (int_t j=0; j<*m_nac; ++j){
+		if (removed<k && idx[removed]==j){
+			++removed;
+			continue;
+		}
+		const int_t jn = j - removed;
+		for (int_t i=0; i<m_nz; ++i){
+			temp_nznz[i*m_nz+jn] = (i<=j)?m_R[(j*j + j)/2 + i]:0.0;
+		}
+	}
+
+	// retriangularize columns to the right of the first removed column
+	for (int_t j=idx[0]; j<nac_new; ++j){
+		// number of nonzero elements below the diagonal is bounded by k
+		int_t len = 1;
+		for (int_t i=j+1; i<m_nz && i<=j+k; ++i){
+			if (temp_nznz[i*m_nz+j] != 0.0){
+				len = i-j+1;
+			}
+		}
+		if (len == 1){
+			continue;
+		}
+
+		real_t beta = householder(&temp_nznz[j*m_nz+j],len,m_nz);
+		for (int_t i=0; i<len; ++i){
+			temp_v[i] = temp_nznz[(j+i)*m_nz+j];
+		}
+		temp_v[0] = 1.0;
+		for (int_t i=1; i<len; ++i){
+			temp_nznz[(j+i)*m_nz+j] = 0.0;
+		}
+
+		if (beta != 0.0){
+			// apply to columns on the right
+			for (int_t c=j+1; c<nac_new; ++c){
+				real_t val = 0.0;
+				for (int_t i=0; i<len; ++i){
+					val += temp_v[i]*temp_nznz[(j+i)*m_nz+c];
+				}
+				val *= beta;
+				for (int_t i=0; i<len; ++i){
+					temp_nznz[(j+i)*m_nz+c] -= val*temp_v[i];
+				}
+			}
+
+			// Qnew = Qold*H
+			householderQUpdate(temp_v,beta,j,len,Q);
+		}
+	}
+
+	// pack the triangular matrix back into R
+	for (int_t j=0; j<nac_new; ++j){
+		for (int_t i=0; i<j+1; ++i){
+			m_R[(j*j + j)/2 + i] = temp_nznz[i*m_nz+j];
+		}
+	}
+	
+	// set elements in the removed columns to zero
+	for (int_t i=(nac_new*nac_new + nac_new)/2; i<(*m_nac* *m_nac + *m_nac)/2; ++i){
+		m_R[i] = 0.0;
+	}
+}
+
+real_t Rmatrix::householder(real_t *const x, const int_t n, const int_t inc){
+	real_t sigma = 0.0;
+	for (int_t i=1; i<n; ++i){
+		sigma += x[i*inc]*x[i*inc];
+	}
+	if (sigma == 0.0){
+		// nothing to eliminate
+		return 0.0;
+	}
+
+	real_t nrm = sqrt(x[0]*x[0] + sigma);
+	real_t alpha = (x[0]>0)?-nrm:nrm;
+	real_t v0 = x[0] - alpha;
+
+	// scale v such that v[0] = 1
+	for (int_t i=1; i<n; ++i){
+		x[i*inc] /= v0;
+	}
+	x[0] = alpha;
+
+	return -v0/alpha;							// beta = 2/(v'*v)
+}
+
+void Rmatrix::householderQUpdate(const real_t *const v, const real_t beta, const int_t r, const int_t n, real_t *const Q){
+	// Q(:,r:r+n-1) = Q(:,r:r+n-1)*(I - beta*v*v')
+	for (int_t i=0; i<m_nz; ++i){
+		real_t *const Qi = &Q[i*m_nz+r];
+		real_t val;
+		Utils::DotProduct(Qi,v,n,val);
+		val *= beta;
+		for (int_t j=0; j<n; ++j){
+			Qi[j] -= val*v[j];
+		}
+	}
+}
+
 void Rmatrix::givens(const real_t x, const real_t y){
 	real_t absx = x>=0?x:-x;
 	if(x==0.0){
@@ -146,6 +302,16 @@ void Rmatrix::performRTRSubstitution(real_t *const vec1){
 	}
 }
 
+void Rmatrix::performRSubstitution(real_t *const vec1){
+	// vec1 = R\vec1;
+	for (int i=*m_nac-1; i>=0; --i){  // each row
+		for (int j=*m_nac-1;j>i; --j){ // each column
+			vec1[i] -= m_R[(j*j+j)/2+i]*vec1[j];
+		}
+		vec1[i] = vec1[i]/m_R[(i*i+3*i)/2];
+	}
+}
+
 bool Rmatrix::getLD_Flag()
 {	// returns flag to indicate if the constraint set is linearly dependent
 	/* implemented as a calculation every time it is called than a member variable, because
@@ -162,3 +328,11 @@ bool Rmatrix::getLD_Flag()
 
 	return false;
 }
+
+void Rmatrix::getR(real_t *const R_out) const{
+	Utils::VectorCopy(m_R, R_out, (*m_nac* *m_nac + *m_nac)/2);
+}
+
+void Rmatrix::setR(const real_t *const R_in){
+	Utils::VectorCopy(R_in, m_R, (*m_nac* *m_nac + *m_nac)/2);
+}
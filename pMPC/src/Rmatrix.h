@@ -24,13 +24,42 @@ public:
 	 * \param idx is the index of the column to be removed
 	 */
 	void downdateR(const int_t idx);
+
+	/* \brief add k columns to R matrix in one pass
+	 *
+	 * The trailing rows of the new columns are triangularized with Householder reflections,
+	 * which are applied to Q directly (Qnew = Qold*H), so multiplyGqT must not be called afterwards.
+	 * \param cols contains the k columns QT*Li*a stored one after the other (overwritten)
+	 * \param k is the number of columns to be added
+	 * \param Q is the Q matrix of the QR decomposition
+	 */
+	void updateRBlock(real_t *const cols, const int_t k, real_t *const Q);
+
+	/* \brief remove k columns from R matrix in one pass
+	 *
+	 * The columns to the right of the removed ones are retriangularized with Householder reflections,
+	 * which are applied to Q directly (Qnew = Qold*H), so multiplyGqT must not be called afterwards.
+	 * \param idx contains the indices of the columns to be removed in ascending order
+	 * \param k is the number of columns to be removed
+	 * \param Q is the Q matrix of the QR decomposition
+	 */
+	void downdateRBlock(const int_t *const idx, const int_t k, real_t *const Q);
 	
 	/// returns the value inv(R^T*R)*vec1 in the same vector vec1.
 	void performRTRSubstitution(real_t *const vec1);
 
+	/// returns the value inv(R)*vec1 in the same vector vec1.
+	void performRSubstitution(real_t *const vec1);
+
 	/// return flag to indicate if the constraint set is linearly dependent
 	bool getLD_Flag();
 
+	/// copy the nac columns of R (packed column wise, nac*(nac+1)/2 elements) to R_out
+	void getR(real_t *const R_out) const;
+
+	/// set the nac columns of R (packed column wise), e.g. from a snapshot of the solver
+	void setR(const real_t *const R_in);
+
 	/* \brief multiplies the input matrix with Gq^T
 	 * 
 	 * This is used to update the Q matrix in the QR decomposition. Whenever
@@ -44,6 +73,14 @@ private:
 	
 	// update the current givens matrix at positions r1 and r2
 	void givensMatUpdate(const int_t r1, const int_t r2);
+
+	/* compute the Householder vector v (in place) for the n elements of x with stride inc,
+	 * returns beta such that (I - beta*v*v')*x = [alpha;0] with alpha stored in x[0]
+	 */
+	real_t householder(real_t *const x, const int_t n, const int_t inc);
+
+	// apply the Householder reflection (v,beta) to rows r..r+n-1 of Q from the right
+	void householderQUpdate(const real_t *const v, const real_t beta, const int_t r, const int_t n, real_t *const Q);
 	
 	real_t	*m_R,										// R matrix
 			
@@ -54,7 +91,8 @@ private:
 			// temporary variables
 			*temp_nz,
 			*temp_nz2,
-			*temp_nznz;
+			*temp_nznz,
+			*temp_v;									// Householder vector
 									
 	const int_t m_nz;
 	const int_t *const m_nac;
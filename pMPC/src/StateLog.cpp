@@ -0,0 +1,96 @@
+#include "StateLog.h"
+
+namespace {
+	const int_t LOG_MAGIC = 0x4c504d70;		///< "pMPL" at the start of a log
+	const int_t LOG_VERSION = 1;
+	const int_t LOG_HEADER = 6;				///< magic, version, n, m, outputs, snapshot size
+
+	/// size of the stdio buffer, records are written to the file in large blocks
+	const size_t BUFFER_SIZE = 1<<16;
+}
+
+StateLog::StateLog(): file(0), n(0), m(0), outputs(false){
+}
+
+StateLog::~StateLog(){
+	close();
+}
+
+bool StateLog::create(const char *const filename, const int_t n_i, const int_t m_i, const bool outputs_i,
+	const char *const snapshot_i, const int_t snapshotSize_i){
+	close();
+	if ((file = fopen(filename, "wb")) == 0){
+		printf("\n\runable to write file %s\n", filename);
+		return false;
+	}
+	setvbuf(file, 0, _IOFBF, BUFFER_SIZE);
+	n = n_i;
+	m = m_i;
+	outputs = outputs_i;
+	snapshot.assign(snapshot_i, snapshot_i+snapshotSize_i);
+
+	const int_t header[LOG_HEADER] = {LOG_MAGIC, LOG_VERSION, n, m, outputs?1:0, snapshotSize_i};
+	return fwrite(header, sizeof(int_t), LOG_HEADER, file) == (size_t)LOG_HEADER &&
+		fwrite(snapshot_i, 1, snapshotSize_i, file) == (size_t)snapshotSize_i;
+}
+
+bool StateLog::open(const char *const filename){
+	close();
+	if ((file = fopen(filename, "rb")) == 0){
+		printf("\n\runable to read file %s\n", filename);
+		return false;
+	}
+	int_t header[LOG_HEADER];
+	if (fread(header, sizeof(int_t), LOG_HEADER, file) != (size_t)LOG_HEADER || header[0] != LOG_MAGIC ||
+		header[1] != LOG_VERSION || header[2] <= 0 || header[3] <= 0 || header[5] < 0){
+		printf("%s is not a state log.\n", filename);
+		close();
+		return false;
+	}
+	n = header[2];
+	m = header[3];
+	outputs = (header[4] != 0);
+	snapshot.resize(header[5]);
+	if (!snapshot.empty() && fread(snapshot.data(), 1, snapshot.size(), file) != snapshot.size()){
+		printf("%s is truncated.\n", filename);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void StateLog::close(){
+	if (file){
+		fclose(file);
+		file = 0;
+	}
+}
+
+bool StateLog::append(const real_t *const x0, const real_t *const u, const int_t iterations, const int_t exitFlag){
+	if (!file){
+		return false;
+	}
+	bool ok = (fwrite(x0, sizeof(real_t), n, file) == (size_t)n);
+	if (outputs){
+		const int_t stats[2] = {iterations, exitFlag};
+		ok = ok && fwrite(u, sizeof(real_t), m, file) == (size_t)m && fwrite(stats, sizeof(int_t), 2, file) == 2;
+	}
+	return ok;
+}
+
+bool StateLog::next(real_t *const x0, real_t *const u, int_t &iterations, int_t &exitFlag){
+	iterations = exitFlag = 0;
+	if (!file || fread(x0, sizeof(real_t), n, file) != (size_t)n){
+		return false;
+	}
+	if (outputs){
+		const bool read_u = u?(fread(u, sizeof(real_t), m, file) == (size_t)m):(fseek(file, m*sizeof(real_t), SEEK_CUR) == 0);
+		int_t stats[2];
+		if (!read_u || fread(stats, sizeof(int_t), 2, file) != 2){
+			return false;
+		}
+		iterations = stats[0];
+		exitFlag = stats[1];
+	}
+	return true;
+}
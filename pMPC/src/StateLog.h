@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+#include "DefineSettings.h"
+
+/*!
+ * \class StateLog
+ * \brief Binary log of the states given to MPCSolver::solve, for the replay of recorded workloads.
+ *
+ * The log starts with a header (magic, version, n, m, output flag, size of the snapshot) and a snapshot
+ * of the solver state at the start of the recording (see QPSolver::saveSnapshot), so a replay starts
+ * from the same active set. Each record contains the state x0 and, if outputs are recorded, the control
+ * inputs u, the number of iterations and the exit flag of the solve. Values are stored in the native
+ * format of real_t and int_t, so a log is read on the same kind of machine.
+ */
+class StateLog{
+public:
+	/// constructor: the log is closed
+	StateLog();
+
+	/// destructor: closes the file
+	~StateLog();
+
+	/*!
+	 * \brief create a log file
+	 *
+	 * \param file is the path of the file
+	 * \param n_i, m_i are the numbers of states and control inputs
+	 * \param outputs_i records u, the iterations and the exit flag with each state
+	 * \param snapshot, snapshotSize_i is the solver state at the start (snapshotSize_i can be 0)
+	 * \return false if the file cannot be written
+	 */
+	bool	create(const char *const file, const int_t n_i, const int_t m_i, const bool outputs_i,
+		const char *const snapshot = 0, const int_t snapshotSize_i = 0);
+
+	/// open a log file for reading, false if it cannot be read or is not a log
+	bool	open(const char *const file);
+
+	/// close the file, a created log is complete afterwards
+	void	close();
+
+	/// append a record, u, iterations and exitFlag are ignored if no outputs are recorded
+	bool	append(const real_t *const x0, const real_t *const u, const int_t iterations, const int_t exitFlag);
+
+	/*!
+	 * \brief read the next record
+	 *
+	 * \param x0 returns the state (n values)
+	 * \param u returns the control inputs (m values) if outputs are recorded and u is not NULL
+	 * \param iterations, exitFlag return the recorded values (0 without outputs)
+	 * \return false at the end of the log
+	 */
+	bool	next(real_t *const x0, real_t *const u, int_t &iterations, int_t &exitFlag);
+
+	/// returns the number of states
+	int_t	getNumberOfStates() const {return n;}
+
+	/// returns the number of control inputs
+	int_t	getNumberOfOutputs() const {return m;}
+
+	/// returns true if the records contain u, the iterations and the exit flag
+	bool	hasOutputs() const {return outputs;}
+
+	/// returns the snapshot of the solver state at the start of the recording (empty if none)
+	const std::vector<char>& getSnapshot() const {return snapshot;}
+
+private:
+	FILE	*file;
+
+	int_t	n,					///< number of states
+			m;					///< number of control inputs
+
+	bool	outputs;			///< records contain the outputs of the solve
+
+	std::vector<char>	snapshot;	///< solver state at the start of the recording
+};
@@ -0,0 +1,68 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(const int_t nthreads):
+	m_nthreads(nthreads>1?nthreads:1), m_task(0), m_generation(0), m_pending(0), m_stop(false)
+{
+	for (int_t i = 1; i < m_nthreads; ++i){
+		m_threads.push_back(std::thread(&ThreadPool::work, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool(){
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_start.notify_all();
+	for (size_t i = 0; i < m_threads.size(); ++i){
+		m_threads[i].join();
+	}
+}
+
+void ThreadPool::run(const std::function<void(const int_t)> &task){
+	if (m_nthreads == 1){
+		task(0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_pending = m_nthreads-1;
+		++m_generation;
+	}
+	m_start.notify_all();
+
+	task(0);
+
+	// wait for the workers
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]{return m_pending == 0;});
+	m_task = 0;
+}
+
+void ThreadPool::work(const int_t i){
+	unsigned long generation = 0;
+	while (true){
+		const std::function<void(const int_t)> *task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [this, generation]{return m_stop || m_generation != generation;});
+			if (m_stop){
+				return;
+			}
+			generation = m_generation;
+			task = m_task;
+		}
+
+		(*task)(i);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_pending;
+			if (m_pending == 0){
+				m_done.notify_one();
+			}
+		}
+	}
+}
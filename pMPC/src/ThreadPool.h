@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "DefineSettings.h"
+
+/*! \class ThreadPool
+ * \brief Persistent worker threads for the data parallel parts of the solvers.
+ *
+ * The threads are started once and wait for work between calls to run, so a parallel
+ * section only costs a wake-up and a barrier. The calling thread takes part as thread 0.
+ */
+class ThreadPool{
+public:
+	/*!
+	 * \brief constructor
+	 *
+	 * \param nthreads is the number of threads including the calling thread
+	 */
+	ThreadPool(const int_t nthreads);
+
+	/// destructor: stops and joins the worker threads
+	~ThreadPool();
+
+	/// returns the number of threads including the calling thread
+	int_t	getNumThreads() const {return m_nthreads;}
+
+	/*!
+	 * \brief run task(i) on thread i for i = 0 to nthreads-1
+	 *
+	 * task(0) runs on the calling thread. The function returns when all tasks are finished.
+	 * run must not be called from several threads at the same time.
+	 */
+	void	run(const std::function<void(const int_t)> &task);
+
+private:
+	/// main loop of worker thread i
+	void	work(const int_t i);
+
+	int_t	m_nthreads;
+
+	std::vector<std::thread>	m_threads;
+
+	std::mutex					m_mutex;
+	std::condition_variable		m_start,		///< signals a new task to the workers
+								m_done;			///< signals the end of the last task
+
+	const std::function<void(const int_t)> *m_task;	///< current task
+
+	unsigned long	m_generation;	///< number of tasks started, workers wait for a change
+	int_t			m_pending;		///< number of workers which have not finished the current task
+	bool			m_stop;			///< workers exit when set
+};
@@ -0,0 +1,124 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+namespace {
+	struct Event{
+		const char	*name;
+		uint64_t	begin,
+					end;
+	};
+
+	/// ring buffer of one thread, only written by its thread
+	struct Buffer{
+		std::atomic<uint64_t>	head;		///< number of events written
+		std::atomic<uint64_t>	first;		///< index of the first event after the last clear
+		int_t					tid;		///< thread number in the trace
+		Event					events[Trace::CAPACITY];
+	};
+
+	/// buffers of all threads which recorded an event, they are kept when a thread exits
+	std::mutex buffersMutex;
+	std::vector<std::unique_ptr<Buffer> > buffers;
+
+	thread_local Buffer *localBuffer = 0;
+
+	/// time stamps at start-up for the conversion of ticks to microseconds
+	const uint64_t originTicks = Trace::now();
+	const std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+
+	Buffer* registerThread(){
+		std::unique_ptr<Buffer> buffer(new Buffer);
+		buffer->head.store(0);
+		buffer->first.store(0);
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		buffer->tid = (int_t)buffers.size();
+		buffers.push_back(std::move(buffer));
+		return buffers.back().get();
+	}
+}
+
+void Trace::record(const char *name, const uint64_t begin, const uint64_t end){
+	Buffer *buffer = localBuffer;
+	if (!buffer){
+		buffer = localBuffer = registerThread();
+	}
+	const uint64_t h = buffer->head.load(std::memory_order_relaxed);
+	Event &e = buffer->events[h & (CAPACITY-1)];
+	e.name = name;
+	e.begin = begin;
+	e.end = end;
+	buffer->head.store(h+1, std::memory_order_release);
+}
+
+bool Trace::exportChrome(const char *file){
+	// ticks per microsecond measured since start-up, over at least 10 ms
+	uint64_t ticks;
+	std::chrono::steady_clock::duration elapsed;
+	do{
+		ticks = now();
+		elapsed = std::chrono::steady_clock::now()-originTime;
+	}while (elapsed < std::chrono::milliseconds(10));
+	const double us = std::chrono::duration<double, std::micro>(elapsed).count();
+	const double tickRate = (double)(ticks-originTicks)/us;
+
+	FILE *fp = fopen(file, "w");
+	if (!fp){
+		return false;
+	}
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	bool comma = false;
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	std::vector<Event> events;
+	for (size_t b = 0; b < buffers.size(); ++b){
+		Buffer &buffer = *buffers[b];
+
+		// copy the events, then drop the ones the thread may have overwritten in the meantime
+		const uint64_t head = buffer.head.load(std::memory_order_acquire);
+		uint64_t start = buffer.first.load(std::memory_order_relaxed);
+		if (head > start+CAPACITY){
+			start = head-CAPACITY;
+		}
+		events.assign(head-start, Event());
+		for (uint64_t i = start; i < head; ++i){
+			events[i-start] = buffer.events[i & (CAPACITY-1)];
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t after = buffer.head.load(std::memory_order_relaxed);
+		const uint64_t valid = (after >= CAPACITY)?after-CAPACITY+1:0;
+
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+			comma?",\n":"", buffer.tid, buffer.tid);
+		comma = true;
+		for (uint64_t i = (start > valid)?start:valid; i < head; ++i){
+			const Event &e = events[i-start];
+			const double ts = (double)(int64_t)(e.begin-originTicks)/tickRate;
+			const double dur = (double)(e.end-e.begin)/tickRate;
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				e.name, buffer.tid, ts, dur);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	return fclose(fp) == 0;
+}
+
+void Trace::clear(){
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for (size_t b = 0; b < buffers.size(); ++b){
+		buffers[b]->first.store(buffers[b]->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}
+
+uint64_t Trace::getNumberOfEvents(){
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	uint64_t count = 0;
+	for (size_t b = 0; b < buffers.size(); ++b){
+		count += buffers[b]->head.load(std::memory_order_acquire)-buffers[b]->first.load(std::memory_order_relaxed);
+	}
+	return count;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+#include "DefineSettings.h"
+
+/*!
+ * \brief Trace of the solver phases for the inspection of single slow solves.
+ *
+ * The trace points are compiled in with the CMake option PMPC_TRACE (PMPC_TRACE_SCOPE is empty
+ * otherwise). Each event stores the name and the begin and end time stamps in a ring buffer of the
+ * recording thread, so recording takes no lock and no system call: two reads of the time stamp
+ * counter (steady_clock on other architectures) and three stores. The buffer keeps the last
+ * CAPACITY events of each thread.
+ *
+ * exportChrome writes the events in the Chrome trace event format, which is read by chrome://tracing
+ * and the Perfetto UI. It can be called while the solvers are running: events which are overwritten
+ * during the export are dropped.
+ */
+class Trace{
+	public:
+
+	/// number of events kept per thread (power of two)
+	static const uint_t CAPACITY = 1u<<15;
+
+	/// returns the current time stamp in ticks of the trace clock
+	static inline uint64_t now(){
+	#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+	#else
+		return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+	#endif
+	}
+
+	/*!
+	 * \brief add an event to the ring buffer of the calling thread
+	 *
+	 * \param name is the name of the phase, it must remain valid until the export (e.g. a literal)
+	 * \param begin, end are the time stamps returned by now
+	 */
+	static void record(const char *name, const uint64_t begin, const uint64_t end);
+
+	/*!
+	 * \brief write the events of all threads to a Chrome trace event JSON file
+	 *
+	 * \param file is the path of the file
+	 * \return false if the file could not be written
+	 */
+	static bool exportChrome(const char *file);
+
+	/// discard the recorded events of all threads
+	static void clear();
+
+	/// returns the number of events recorded by all threads since the last clear (including overwritten ones)
+	static uint64_t getNumberOfEvents();
+
+	/// records the time between construction and destruction
+	class Scope{
+		public:
+		Scope(const char *name_i): name(name_i), begin(now()) {}
+		~Scope(){record(name, begin, now());}
+
+		private:
+		const char	*name;
+		uint64_t	begin;
+	};
+};
+
+#ifdef PMPC_TRACE
+	#define PMPC_TRACE_CONCAT_(a,b) a##b
+	#define PMPC_TRACE_CONCAT(a,b) PMPC_TRACE_CONCAT_(a,b)
+	/// record the rest of the enclosing block as the phase name
+	#define PMPC_TRACE_SCOPE(name) Trace::Scope PMPC_TRACE_CONCAT(pmpc_trace_,__LINE__)(name)
+#else
+	#define PMPC_TRACE_SCOPE(name)
+#endif
@@ -71,6 +71,59 @@ void Utils::LoadVec(const char* str, int_t** vec, int_t& nv){
 		delete [] tmp;
 	}
 	
+bool Utils::SaveVec(const char* str, const real_t* vec, const int_t nv){
+		std::string filename_base=str;
+		filename_base.append(".txt");
+
+		FILE* datafile;
+		if ( ( datafile = fopen( filename_base.c_str(), "w" ) ) == 0 )
+		{
+			printf("\n\runable to write file %s\n",filename_base.c_str());
+			return false;
+		}
+
+		fprintf( datafile, "%d\n", nv );
+		for(int_t k=0;k<nv;++k){
+			fprintf( datafile, "%.16f\n", vec[k] );
+		}
+
+		fclose( datafile );
+		return true;
+	}
+
+bool Utils::SaveVec(const char* str, const int_t* vec, const int_t nv){
+		std::string filename_base=str;
+		filename_base.append(".txt");
+
+		FILE* datafile;
+		if ( ( datafile = fopen( filename_base.c_str(), "w" ) ) == 0 )
+		{
+			printf("\n\runable to write file %s\n",filename_base.c_str());
+			return false;
+		}
+
+		fprintf( datafile, "%d\n", nv );
+		for(int_t k=0;k<nv;++k){
+			fprintf( datafile, "%d\n", vec[k] );
+		}
+
+		fclose( datafile );
+		return true;
+	}
+
+bool Utils::FileExists(const char* str){
+		std::string filename_base=str;
+		filename_base.append(".txt");
+
+		FILE* datafile;
+		if ( ( datafile = fopen( filename_base.c_str(), "r" ) ) == 0 )
+		{
+			return false;
+		}
+		fclose( datafile );
+		return true;
+	}
+
 int_t Utils::readFromFile(int_t* data, int_t n, const char* datafilename){
 		
 		int_t i;
@@ -105,6 +158,21 @@ void Utils::DotProduct(const real_t* a, const real_t* b, const int& n, real_t& r
 	}
 
 
+void Utils::DotProduct4(const real_t* matA, const real_t* b, const int_t n, real_t* res){
+		const real_t *a0 = matA, *a1 = matA+n, *a2 = matA+2*n, *a3 = matA+3*n;
+		real_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+		for(int_t i=0;i<n;++i){
+			r0+=a0[i]*b[i];
+			r1+=a1[i]*b[i];
+			r2+=a2[i]*b[i];
+			r3+=a3[i]*b[i];
+		}
+		res[0] = r0;
+		res[1] = r1;
+		res[2] = r2;
+		res[3] = r3;
+	}
+
 void Utils::VectorAdd(const real_t* a, const real_t* b, real_t* c, int_t n){
 		for(int_t k=0;k<n;++k){
 			c[k]=a[k]+b[k];
@@ -190,6 +258,67 @@ void Utils::MatrixTranspose(const real_t* matA, real_t* matB,const int_t rowsA,c
 	}
 }
 
+void Utils::MatTDiagMatMult(const real_t* matA, const real_t* d, const real_t* matB, real_t* matC, 
+						const int_t rowsA, const int_t colsA, const int_t colsB){
+	// sum of the weighted outer products of the rows, the rows of A and B are read once
+	for (int_t i = 0; i<colsA*colsB; ++i){
+		matC[i] = 0;
+	}
+	for (int_t k = 0; k<rowsA; ++k){
+		if (d[k] == 0){
+			continue;
+		}
+		for (int_t i = 0; i<colsA; ++i){
+			const real_t a = d[k]*matA[k*colsA+i];
+			for (int_t j = 0; j<colsB; ++j){
+				matC[i*colsB+j] += a*matB[k*colsB+j];
+			}
+		}
+	}
+}
+
+bool Utils::Cholesky(const real_t* matA, real_t* matL, const int_t n){
+	for (int_t j = 0; j<n; ++j){
+		real_t val = matA[j*n+j];
+		for (int_t k = 0; k<j; ++k){
+			val -= matL[j*n+k]*matL[j*n+k];
+		}
+		if (!(val > 0)){
+			return false;
+		}
+		matL[j*n+j] = sqrt(val);
+
+		for (int_t i = j+1; i<n; ++i){
+			val = matA[i*n+j];
+			for (int_t k = 0; k<j; ++k){
+				val -= matL[i*n+k]*matL[j*n+k];
+			}
+			matL[i*n+j] = val/matL[j*n+j];
+		}
+		for (int_t i = 0; i<j; ++i){
+			matL[i*n+j] = 0;
+		}
+	}
+	return true;
+}
+
+void Utils::LowerTriangularInverse(const real_t* matL, real_t* matLi, const int_t n){
+	// forward substitution for each column of the identity
+	for (int_t j = 0; j<n; ++j){
+		for (int_t i = 0; i<j; ++i){
+			matLi[i*n+j] = 0;
+		}
+		matLi[j*n+j] = 1/matL[j*n+j];
+		for (int_t i = j+1; i<n; ++i){
+			real_t val = 0;
+			for (int_t k = j; k<i; ++k){
+				val -= matL[i*n+k]*matLi[k*n+j];
+			}
+			matLi[i*n+j] = val/matL[i*n+i];
+		}
+	}
+}
+
 void Utils::ForwardSubstitution(const real_t* matA, real_t* v1, const int_t rowsA, const int_t colsA){
 	// This function assumes matA is lower triangular, and # of rows <= # of cols
 	// It updates the same vector v1 with new values
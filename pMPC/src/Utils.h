@@ -26,12 +26,33 @@ class Utils{
 	 */
 	static void LoadVec(const char* str, int_t** vec, int_t& nv);
 
+	/*!
+	 * \brief function to save data to .txt files in the format read by LoadVec
+	 *
+	 * \param str is the path to the file
+	 * \param vec is the data
+	 * \param nv is the size of the vector
+	 * \return false if the file could not be written
+	 */
+	static bool SaveVec(const char* str, const real_t* vec, const int_t nv);
+
+	/// save integer data to str.txt in the format read by LoadVec
+	static bool SaveVec(const char* str, const int_t* vec, const int_t nv);
+
+	/// returns true if the file str.txt exists
+	static bool FileExists(const char* str);
+
 
 	/*!
 	 * \brief performs dot product a.b = res, where a and b are n-dimensional
 	 */
 	static void DotProduct(const real_t* a, const real_t* b, const int& n, real_t& res);
 
+	/*!
+	 * \brief performs four dot products res[k] = A(k,:).b with four consecutive rows of A (n columns)
+	 */
+	static void DotProduct4(const real_t* matA, const real_t* b, const int_t n, real_t* res);
+
 	
 	/*!
 	 * \brief implements a+b=c, where a,b,c are n-dimensional
@@ -83,6 +104,16 @@ class Utils{
 	/// B = A^T (matrices stored row wise)
 	static void MatrixTranspose(const real_t* matA, real_t* matB,const int_t rowsA,const int_t colsA);
 
+	/// performs matC = matA^T*diag(d)*matB, where matA and matB have rowsA rows
+	static void MatTDiagMatMult(const real_t* matA, const real_t* d, const real_t* matB, real_t* matC, 
+						const int_t rowsA, const int_t colsA, const int_t colsB);
+
+	/// Cholesky decomposition matA = matL*matL^T, returns false if matA is not positive definite
+	static bool Cholesky(const real_t* matA, real_t* matL, const int_t n);
+
+	/// inverse of the lower triangular matrix matL
+	static void LowerTriangularInverse(const real_t* matL, real_t* matLi, const int_t n);
+
 	/// solves x = inv(A)*b, where A is lower triangular
 	static void ForwardSubstitution(const real_t* matA,  real_t* v1,const int_t rowsA, const int_t colsA);
 
@@ -2,6 +2,7 @@
 #include "MPCSolver.h"
 #include "DefineSettings.h"
 #include "Utils.h"
+#include "Trace.h"
 #include <cmath>
 #include <string>
 
@@ -45,6 +46,11 @@ int main(){
 		Utils::VectorAdd(Ax,Bu,&x[n*(i+1)],n);
 	}
 
+#ifdef PMPC_TRACE
+	// solver phases for chrome://tracing or ui.perfetto.dev
+	Trace::exportChrome("trace.json");
+#endif
+
 	delete[] x;
 	delete[] u;
 	delete[] Ax;
@@ -0,0 +1,96 @@
+#include "MPCSolver.h"
+#include "DefineSettings.h"
+#include "Utils.h"
+#include "pMPC_generated.h"
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <string>
+
+/*
+ * Benchmark of the generated controller against the generic MPCSolver. Both controllers are run in
+ * closed loop on the same trajectory (the one of the generic solver) and the per-step latency and
+ * the largest difference in the control inputs are reported.
+ *
+ * Usage: pMPC_bench_codegen <problem directory> [number of steps]
+ */
+
+int main(int argc, char **argv){
+	if (argc < 2){
+		printf("usage: %s <problem directory> [number of steps]\n",argv[0]);
+		return 1;
+	}
+	std::string dir = argv[1];
+	int_t tmax = (argc > 2)?atoi(argv[2]):1000;
+
+	real_t *A,*B;
+	int_t n,m,temp;
+
+	// load matrices A and B
+	std::string tmp = dir+"/A";
+	Utils::LoadVec(tmp.c_str(),&A,temp);
+	n = (int_t)sqrt(temp);
+
+	tmp = dir+"/B";
+	Utils::LoadVec(tmp.c_str(),&B,temp);
+	m = temp/n;
+
+	if (n != pMPC_gen::N || m != pMPC_gen::M){
+		printf("generated controller does not match the problem in %s\n",dir.c_str());
+		return 1;
+	}
+
+	real_t *Ax = new real_t[n];
+	real_t *Bu = new real_t[n];
+	real_t *x = new real_t[n];
+	real_t *u = new real_t[m];
+	real_t *u_gen = new real_t[m];
+
+	MPCSolver pmpc(dir);
+	pmpc.setEngine(DUAL_ENGINE);
+	pMPC_gen::Controller ctrl;
+
+	double t_gen = 0.0, t_pmpc = 0.0, max_diff = 0.0;
+	int_t n_fail = 0;
+
+	for (int_t i=0; i<n; ++i){
+		x[i] = 0.3;
+	}
+
+	for (int_t i=0; i<tmax-1; ++i){
+		auto t0 = std::chrono::steady_clock::now();
+		pmpc.solve(x);
+		auto t1 = std::chrono::steady_clock::now();
+		ctrl.solve(x);
+		auto t2 = std::chrono::steady_clock::now();
+
+		t_pmpc += std::chrono::duration<double,std::micro>(t1-t0).count();
+		t_gen += std::chrono::duration<double,std::micro>(t2-t1).count();
+
+		pmpc.getControlInputs(u);
+		ctrl.getControlInputs(u_gen);
+		for (int_t j=0; j<m; ++j){
+			max_diff = std::max(max_diff,std::fabs(u[j]-u_gen[j]));
+		}
+		if (ctrl.getExitFlag() != 0){
+			++n_fail;
+		}
+
+		Utils::MatrixMult(A,x,Ax,n,n,1);
+		Utils::MatrixMult(B,u,Bu,n,m,1);
+		Utils::VectorAdd(Ax,Bu,x,n);
+	}
+
+	printf("MPCSolver:  %.3f us/step\n",t_pmpc/(tmax-1));
+	printf("generated:  %.3f us/step\n",t_gen/(tmax-1));
+	printf("max |u - u_gen| = %g, unsolved steps of the generated controller: %d\n",max_diff,n_fail);
+
+	delete[] A;
+	delete[] B;
+	delete[] Ax;
+	delete[] Bu;
+	delete[] x;
+	delete[] u;
+	delete[] u_gen;
+	return 0;
+}
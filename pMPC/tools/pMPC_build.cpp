@@ -0,0 +1,56 @@
+#include "ProblemBuilder.h"
+#include "DefineSettings.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+/*
+ * Offline builder of parameterized MPC problems, the C++ version of Matlab/generateSolver.m.
+ *
+ * Reads the system, cost, constraints and basis functions from a specification directory (see
+ * ProblemSpec::load) and writes the problem directory read by MPCSolver, pMPC_codegen and the MATLAB
+ * interface. The constraints are imposed at the time steps given by time_indices in the specification,
+ * up to t_star of the maximal output admissible set if the specification contains moas = [maxSize; window]
+ * (Matlab/generateMOAS.m), or at all time steps up to the horizon.
+ *
+ * Usage: pMPC_build <specification directory> <problem directory> [number of threads]
+ */
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		printf("usage: %s <specification directory> <problem directory> [number of threads]\n",argv[0]);
+		return 1;
+	}
+	const std::string dir = argv[2];
+	const int_t nthreads = (argc > 3)?atoi(argv[3]):1;
+
+	ProblemSpec spec;
+	if (!spec.load(argv[1])){
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	ProblemBuilder builder(spec, nthreads);
+	if (!builder.build()){
+		return 1;
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+	_mkdir(dir.c_str());
+#else
+	mkdir(dir.c_str(), 0755);
+#endif
+	if (!builder.save(dir)){
+		return 1;
+	}
+
+	printf("Built %s: nz = %d, nc = %d, t_star = %d in %.1f ms.\n",dir.c_str(),builder.getNumberOfVariables(),
+		builder.getNumberOfConstraints(),builder.getTStar(),std::chrono::duration<double,std::milli>(t1-t0).count());
+	return 0;
+}
@@ -0,0 +1,263 @@
+#include "MPCSolver.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "DefineSettings.h"
+#include "Utils.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+/*
+ * Worst case search of the iterations and the solve time of MPCSolver over a box of initial states.
+ *
+ * Every state is solved from a cold start (the empty active set of a new solver), so the result does not
+ * depend on the order of the states. The box is first sampled on a regular grid, then the states with
+ * the most iterations are refined in several rounds: the neighbours along each axis and random states in
+ * a cube around them, with half the distance in each round. The states of each round are solved in
+ * parallel with one solver per thread. The time of a solve is the fastest of REPEATS runs, measured in
+ * ticks of the trace clock (the time stamp counter on x86) and in microseconds.
+ *
+ * The iterations and the time are reported for the solved states (exit flag 0), which bound the feasible
+ * region, and separately for the states with other exit flags (e.g. infeasible). All solved states are
+ * written to a CSV file (states with 17 digits so they can be solved again exactly, iterations, exit
+ * flag, QR updates, ticks, microseconds, round) for heat maps of the iterations over pairs of states.
+ *
+ * Usage: pMPC_certify <problem directory> <state box> [grid points per state] [refinement rounds]
+ *	[number of threads] [csv file]
+ * The state box is a file in the format of Utils::LoadVec with [xl; xu].
+ */
+
+namespace {
+	/// solves of each state, the fastest one is reported
+	const int_t REPEATS = 3;
+
+	/// states with the most iterations which are refined in each round
+	const int_t REFINED = 16;
+
+	/// largest number of grid points
+	const double MAX_GRID = 1e6;
+
+	struct Sample{
+		std::vector<real_t> x;
+		int_t	iterations,
+				exitFlag,
+				updates,
+				round;
+		uint64_t ticks;
+		double	us;
+	};
+
+	/// file name without the extension .txt added by Utils::LoadVec
+	std::string baseName(std::string file){
+		if (file.size() > 4 && file.compare(file.size()-4, 4, ".txt") == 0){
+			file.resize(file.size()-4);
+		}
+		return file;
+	}
+
+	/// more iterations first, then more QR updates (not the time, so the refinement is reproducible)
+	bool worse(const Sample &a, const Sample &b){
+		return (a.iterations != b.iterations)?(a.iterations > b.iterations):(a.updates > b.updates);
+	}
+
+	/// solve the samples first to last with one solver per thread, each from the cold state
+	void solveSamples(std::vector<Sample> &samples, const size_t first, ThreadPool &pool,
+		std::vector<MPCSolver*> &solvers, const std::vector<char> &cold){
+		const size_t count = samples.size()-first;
+		const int_t nth = pool.getNumThreads();
+		pool.run([&](const int_t th){
+			MPCSolver &solver = *solvers[th];
+			for (size_t i = first+count*th/nth; i < first+count*(th+1)/nth; ++i){
+				Sample &s = samples[i];
+				s.ticks = 0;
+				s.us = INFVAL;
+				for (int_t rep = 0; rep < REPEATS; ++rep){
+					solver.restoreSnapshot(cold.data(), (int_t)cold.size());
+					const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+					const uint64_t c0 = Trace::now();
+					solver.solve(&s.x[0]);
+					const uint64_t c1 = Trace::now();
+					const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+					if (rep == 0 || c1-c0 < s.ticks){
+						s.ticks = c1-c0;
+					}
+					s.us = std::min(s.us, std::chrono::duration<double,std::micro>(t1-t0).count());
+				}
+				s.iterations = solver.getIterNumber();
+				s.exitFlag = solver.getExitFlag();
+				s.updates = solver.getUpdateCount();
+			}
+		});
+	}
+}
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		printf("usage: %s <problem directory> <state box> [grid points per state] [refinement rounds] "
+			"[number of threads] [csv file]\n",argv[0]);
+		return 1;
+	}
+	const std::string dir = argv[1], box = baseName(argv[2]);
+	const int_t npoints = (argc > 3)?atoi(argv[3]):5;
+	const int_t rounds = (argc > 4)?atoi(argv[4]):4;
+	const int_t nthreads = (argc > 5)?atoi(argv[5]):1;
+	const std::string csv = (argc > 6)?argv[6]:"certify.csv";
+
+	if (!Utils::FileExists(box.c_str())){
+		printf("unable to read %s.txt\n",box.c_str());
+		return 1;
+	}
+	real_t *bounds;
+	int_t nb;
+	Utils::LoadVec(box.c_str(),&bounds,nb);
+	const std::vector<real_t> xl(bounds, bounds+nb/2), xu(bounds+nb/2, bounds+nb);
+	delete[] bounds;
+
+	ThreadPool pool(nthreads);
+	std::vector<MPCSolver*> solvers(pool.getNumThreads());
+	for (size_t th = 0; th < solvers.size(); ++th){
+		solvers[th] = new MPCSolver(dir);
+	}
+	const int_t n = solvers[0]->getProblemData()->n;
+	if ((int_t)xl.size() != n || nb != 2*n){
+		printf("the box does not have 2*n = %d bounds\n",2*n);
+		return 1;
+	}
+	if (npoints < 2 || std::pow((double)npoints, n) > MAX_GRID){
+		printf("the grid needs 2 to %g points in total\n",MAX_GRID);
+		return 1;
+	}
+	std::vector<char> cold(solvers[0]->getSnapshotSize());
+	solvers[0]->saveSnapshot(cold.data());
+
+	// regular grid including the corners of the box
+	std::vector<Sample> samples;
+	std::vector<int_t> idx(n, 0);
+	std::vector<real_t> cell(n);
+	for (int_t k = 0; k < n; ++k){
+		cell[k] = (xu[k]-xl[k])/(npoints-1);
+	}
+	for (bool done = false; !done;){
+		Sample s;
+		s.x.resize(n);
+		s.round = 0;
+		for (int_t k = 0; k < n; ++k){
+			s.x[k] = xl[k]+idx[k]*cell[k];
+		}
+		samples.push_back(s);
+		int_t k = 0;
+		while (k < n && ++idx[k] == npoints){
+			idx[k++] = 0;
+		}
+		done = (k == n);
+	}
+	solveSamples(samples, 0, pool, solvers, cold);
+
+	// refinement around the states with the most iterations
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<real_t> uniform(-1.0, 1.0);
+	real_t radius = 0.5;
+	for (int_t round = 1; round <= rounds; ++round, radius *= 0.5){
+		std::vector<Sample> worst(samples);
+		const size_t nref = std::min((size_t)REFINED, worst.size());
+		std::stable_sort(worst.begin(), worst.end(), worse);
+
+		const size_t first = samples.size();
+		for (size_t i = 0; i < nref; ++i){
+			for (int_t j = 0; j < 4*n; ++j){
+				Sample s = worst[i];
+				s.round = round;
+				for (int_t k = 0; k < n; ++k){
+					// 2*n neighbours along the axes, then 2*n random states in the cube
+					const real_t step = (j < 2*n)?((j/2 == k)?((j%2)?-1.0:1.0):0.0):uniform(rng);
+					s.x[k] = std::min(xu[k], std::max(xl[k], s.x[k]+step*radius*cell[k]));
+				}
+				samples.push_back(s);
+			}
+		}
+		solveSamples(samples, first, pool, solvers, cold);
+	}
+
+	// summary: the bound over the feasible region is given by the solved states (exit flag 0), the
+	// states with other exit flags (e.g. -1 and -4 for infeasible) are reported separately
+	int_t maxUpdates = 0;
+	std::vector<int_t> flags;
+	for (size_t i = 0; i < samples.size(); ++i){
+		maxUpdates = std::max(maxUpdates, samples[i].updates);
+		if (std::find(flags.begin(), flags.end(), samples[i].exitFlag) == flags.end()){
+			flags.push_back(samples[i].exitFlag);
+		}
+	}
+	std::sort(flags.begin(), flags.end());
+
+	printf("%d states solved (%d on the grid, %d rounds of refinement)\n",(int_t)samples.size(),
+		(int_t)std::pow((double)npoints, n),rounds);
+	printf("exit flags:");
+	for (size_t f = 0; f < flags.size(); ++f){
+		int_t count = 0;
+		for (size_t i = 0; i < samples.size(); ++i){
+			count += (samples[i].exitFlag == flags[f])?1:0;
+		}
+		printf("  %d: %d",flags[f],count);
+	}
+	printf("\n");
+	for (int_t solved = 1; solved >= 0; --solved){
+		const Sample *most = 0, *slowest = 0;
+		for (size_t i = 0; i < samples.size(); ++i){
+			const Sample &si = samples[i];
+			if ((si.exitFlag == 0) != (solved == 1)){
+				continue;
+			}
+			if (!most || worse(si, *most)){
+				most = &si;
+			}
+			if (!slowest || si.ticks > slowest->ticks){
+				slowest = &si;
+			}
+		}
+		if (!most){
+			continue;
+		}
+		const char *name = solved?"solved states":"states with a nonzero exit flag";
+		printf("%s, most iterations: %d (exit flag %d, %d QR updates) at x0 =",name,most->iterations,
+			most->exitFlag,most->updates);
+		for (int_t k = 0; k < n; ++k){
+			printf(" %.17g",most->x[k]);
+		}
+		printf("\n%s, slowest: %llu ticks, %.3f us, %d iterations (exit flag %d) at x0 =",name,
+			(unsigned long long)slowest->ticks,slowest->us,slowest->iterations,slowest->exitFlag);
+		for (int_t k = 0; k < n; ++k){
+			printf(" %.17g",slowest->x[k]);
+		}
+		printf("\n");
+	}
+	printf("most QR updates: %d\n",maxUpdates);
+
+	FILE *fp = fopen(csv.c_str(), "w");
+	if (!fp){
+		printf("unable to write %s\n",csv.c_str());
+		return 1;
+	}
+	for (int_t k = 0; k < n; ++k){
+		fprintf(fp, "x%d,",k);
+	}
+	fprintf(fp, "iterations,exit_flag,updates,ticks,us,round\n");
+	for (size_t i = 0; i < samples.size(); ++i){
+		const Sample &s = samples[i];
+		for (int_t k = 0; k < n; ++k){
+			fprintf(fp, "%.17g,",s.x[k]);
+		}
+		fprintf(fp, "%d,%d,%d,%llu,%.3f,%d\n",s.iterations,s.exitFlag,s.updates,(unsigned long long)s.ticks,s.us,s.round);
+	}
+	fclose(fp);
+
+	for (size_t th = 0; th < solvers.size(); ++th){
+		delete solvers[th];
+	}
+	return 0;
+}
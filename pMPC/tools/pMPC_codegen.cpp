@@ -0,0 +1,702 @@
+#include "DefineSettings.h"
+#include "Utils.h"
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+ * Offline code generator for parameterized MPC.
+ *
+ * Reads a problem directory (as written by generateSolver.m) and emits a self-contained C++ header
+ * with the problem data as constexpr arrays and a controller specialised to the problem dimensions.
+ * The generated controller performs no I/O and no dynamic allocation. It uses the dual active set
+ * method (as QPSolver with DUAL_ENGINE), fuses the bound update lbineq_c - AiC*x0 into the constraint
+ * check and unrolls the small kernels with Li, LiTLi and the input map into straight-line code.
+ * Constraints with infinite bounds are removed and, for the dense check, duplicate constraints (identical
+ * rows of AiZ and AiC) are merged.
+ *
+ * Usage: pMPC_codegen <problem directory> <output header> [namespace]
+ */
+
+namespace {
+
+// problem data loaded from the directory
+struct ProblemFiles{
+	int_t n, m, s, nz, nc, np, t_star, maxIter;
+	real_t tolMin, tolMax;
+	std::vector<real_t> Li, F, AiZ, AiC, lbineq, ubineq, C, Z, eta2u, C0, C1, tauk, norms, b_l, b_u;
+	std::vector<int_t> time_indices;
+};
+
+bool fileExists(const std::string &name){
+	FILE* file = fopen((name+".txt").c_str(),"r");
+	if (file == 0){
+		return false;
+	}
+	fclose(file);
+	return true;
+}
+
+bool load(const std::string &dir, const char *name, std::vector<real_t> &vec){
+	std::string tmp = dir+"/"+name;
+	if (!fileExists(tmp)){
+		printf("missing file %s.txt\n",tmp.c_str());
+		return false;
+	}
+	real_t *data;
+	int_t nv;
+	Utils::LoadVec(tmp.c_str(),&data,nv);
+	vec.assign(data,data+nv);
+	delete[] data;
+	return true;
+}
+
+bool load(const std::string &dir, const char *name, std::vector<int_t> &vec){
+	std::string tmp = dir+"/"+name;
+	if (!fileExists(tmp)){
+		printf("missing file %s.txt\n",tmp.c_str());
+		return false;
+	}
+	int_t *data;
+	int_t nv;
+	Utils::LoadVec(tmp.c_str(),&data,nv);
+	vec.assign(data,data+nv);
+	delete[] data;
+	return true;
+}
+
+// write a constexpr array
+void writeArray(FILE *file, const char *name, const std::vector<real_t> &vec, const char *size){
+	fprintf(file,"constexpr real_t %s[%s] = {",name,size);
+	for (size_t i=0; i<vec.size(); ++i){
+		if (i%4 == 0){
+			fprintf(file,"\n\t");
+		}
+		fprintf(file,"%.17g, ",vec[i]);
+	}
+	fprintf(file,"\n};\n\n");
+}
+
+void writeArray(FILE *file, const char *name, const std::vector<int_t> &vec, const char *size){
+	fprintf(file,"constexpr int_t %s[%s] = {",name,size);
+	for (size_t i=0; i<vec.size(); ++i){
+		if (i%16 == 0){
+			fprintf(file,"\n\t");
+		}
+		fprintf(file,"%d, ",vec[i]);
+	}
+	fprintf(file,"\n};\n\n");
+}
+
+// write an unrolled kernel vec2 = mat*vec1 (or mat^T*vec1) with the constant matrix mat (rows x cols)
+void writeMatVec(FILE *file, const char *name, const std::vector<real_t> &mat, const int_t rows, const int_t cols, const bool transpose){
+	const int_t nout = transpose?cols:rows;
+	const int_t nin = transpose?rows:cols;
+	fprintf(file,"inline void %s(const real_t *const vec1, real_t *const vec2){\n",name);
+	for (int_t i=0; i<nout; ++i){
+		fprintf(file,"\tvec2[%d] = 0.0",i);
+		for (int_t k=0; k<nin; ++k){
+			real_t val = transpose?mat[k*cols+i]:mat[i*cols+k];
+			if (val != 0.0){
+				fprintf(file," + %.17g*vec1[%d]",val,k);
+			}
+		}
+		fprintf(file,";\n");
+	}
+	fprintf(file,"}\n\n");
+}
+
+// write an unrolled dot product of length n
+void writeDot(FILE *file, const char *name, const int_t n){
+	fprintf(file,"inline real_t %s(const real_t *const a, const real_t *const b){\n\treturn a[0]*b[0]",name);
+	for (int_t i=1; i<n; ++i){
+		fprintf(file," + a[%d]*b[%d]",i,i);
+	}
+	fprintf(file,";\n}\n\n");
+}
+
+// compares two constraint rows of AiZ and AiC
+struct RowLess{
+	const ProblemFiles *P;
+	bool operator()(const int_t a, const int_t b) const{
+		for (int_t k=0; k<P->nz; ++k){
+			if (P->AiZ[a*P->nz+k] != P->AiZ[b*P->nz+k]) return P->AiZ[a*P->nz+k] < P->AiZ[b*P->nz+k];
+		}
+		for (int_t k=0; k<P->n; ++k){
+			if (P->AiC[a*P->n+k] != P->AiC[b*P->n+k]) return P->AiC[a*P->n+k] < P->AiC[b*P->n+k];
+		}
+		return a < b;
+	}
+	bool equal(const int_t a, const int_t b) const{
+		return std::equal(&P->AiZ[a*P->nz],&P->AiZ[a*P->nz]+P->nz,&P->AiZ[b*P->nz]) &&
+			std::equal(&P->AiC[a*P->n],&P->AiC[a*P->n]+P->n,&P->AiC[b*P->n]);
+	}
+};
+
+// solver part of the generated header: does not depend on the constraint check
+const char *solverTemplate = R"PMPC(
+/*!
+ * \brief Controller generated for a single problem.
+ *
+ * Solves the QP of the parameterized MPC problem with the dual active set method. The workspace
+ * is part of the object, so several controllers can be used at the same time.
+ */
+class Controller{
+public:
+	Controller(){
+		for (int_t i = 0; i < M; ++i) u[i] = 0.0;
+		reset();
+	}
+
+	/// solve the QP at one time instance for the state x_IC
+	void solve(const real_t *const x_IC){
+		for (int_t i = 0; i < N; ++i) x[i] = x_IC[i];
+
+		// unconstrained solution zu = -h, h = LiTLi*F*x0
+		mult_LF(x, h);
+
+		// bounds of the active constraints for the new state
+		for (int_t j = 0; j < nac; ++j) w[j] = bound(active[j]);
+
+		iter = 1;
+		exitFlag = 0;
+
+		// start from a dual feasible active set
+		calcLambda();
+		for (int_t j = 0; j < nac; ++j){
+			if (lambda[j] > 0){
+				resetActiveSet();
+				break;
+			}
+		}
+		calc_z();
+
+		while (iter < MAXITER){
+			if (iter == ITER_RELAX) TOL = TOL_MAX;
+
+			checkConstraints();
+			if (!viol){
+				TOL = TOL_MIN;
+				calcInput();
+				return;
+			}
+
+			const int_t p = viol_idx;
+			int_t step = 0;
+			for (; step <= NZ; ++step){
+				direction(p);
+				for (int_t j = 0; j < nac; ++j) r[j] = d[j];
+				substituteR(r);
+				nullspaceStep();
+
+				real_t nrm_d = 0.0, nrm_d2 = 0.0;
+				for (int_t i = 0; i < NZ; ++i){
+					nrm_d += d[i]*d[i];
+					if (i >= nac) nrm_d2 += d[i]*d[i];
+				}
+
+				// partial step length
+				real_t t1 = INF_BOUND;
+				int_t k = -1;
+				for (int_t j = 0; j < nac; ++j){
+					if (r[j] > EPS_RATIO && -lambda[j]/r[j] < t1){
+						t1 = -lambda[j]/r[j];
+						k = j;
+					}
+				}
+
+				// full step length
+				real_t t2 = INF_BOUND;
+				if (nrm_d2 > EPS_RATIO*nrm_d) t2 = error(p)/nrm_d2;
+
+				if (k < 0 && t2 >= INF_BOUND){
+					fail(-4);
+					return;
+				}
+
+				const real_t t = (t1 < t2)?t1:t2;
+				if (t2 < INF_BOUND){
+					for (int_t i = 0; i < NZ; ++i) z[i] -= t*step_z[i];
+				}
+				for (int_t j = 0; j < nac; ++j) lambda[j] += t*r[j];
+
+				if (t2 <= t1){
+					addConstraint(p);
+					calcLambda();
+					calc_z();
+					break;
+				}
+
+				removeConstraint(k);
+				for (int_t j = k; j < nac; ++j) lambda[j] = lambda[j+1];
+			}
+
+			if (step > NZ){
+				fail(-2);
+				return;
+			}
+			++iter;
+		}
+		fail(-3);
+	}
+
+	/// returns control inputs
+	void getControlInputs(real_t *const u_out) const{
+		for (int_t i = 0; i < M; ++i) u_out[i] = u[i];
+	}
+
+	/// returns the solution of the QP
+	void getSolutionCopy(real_t *const z_out) const{
+		for (int_t i = 0; i < NZ; ++i) z_out[i] = z[i];
+	}
+
+	/// get the number of active set iterations
+	int_t getIterNumber() const { return iter; }
+
+	/// get exit flag (same values as QPSolver)
+	int_t getExitFlag() const { return exitFlag; }
+
+	/// empty the active set and tighten the tolerance
+	void reset(){
+		resetActiveSet();
+		TOL = TOL_MIN;
+	}
+
+private:
+	void resetActiveSet(){
+		nac = 0;
+		for (int_t i = 0; i < NZ*NZ; ++i) Q[i] = 0.0;
+		for (int_t i = 0; i < NZ; ++i) Q[i*NZ+i] = 1.0;
+	}
+
+	real_t	x[N],						// current state
+			h[NZ],						// LiTLi*g
+			z[NZ],						// solution
+			lambda[NZ+1],				// Lagrange multipliers (negative)
+			Q[NZ*NZ],					// Q of the QR decomposition of Li*W^T
+			R[NZ*(NZ+1)/2],				// R of the QR decomposition of Li*W^T (packed column wise)
+			W[NZ*NZ],					// active rows (sign inverted for lower bounds)
+			w[NZ],						// active bounds
+			d[NZ],						// QT*Li*a
+			r[NZ],						// change of lambda
+			step_z[NZ],					// change of z
+			tmp[NZ],
+			u[M],
+			TOL;
+
+	int_t	active[NZ],					// active constraints (negative for lower bounds, 1 based)
+			nac,
+			iter,
+			exitFlag,
+			viol_idx;
+
+	bool	viol;
+
+	void fail(const int_t flag){
+		exitFlag = flag;
+		resetActiveSet();
+		TOL = TOL_MAX;
+	}
+
+	// sign inverted bound of constraint idx for the current state
+	real_t bound(const int_t idx) const{
+		const int_t i = (idx > 0)?idx-1:-idx-1;
+		const real_t ax = dot_n(&AiC[i*N], x);
+		return (idx > 0)?UBINEQ_C[i]-ax:ax-LBINEQ_C[i];
+	}
+
+	// violation of constraint idx
+	real_t error(const int_t idx) const{
+		const int_t i = (idx > 0)?idx-1:-idx-1;
+		const real_t val = dot_nz(&AiZ[i*NZ], z);
+		return (idx > 0)?val-bound(idx):-val-bound(idx);
+	}
+
+	void calcLambda(){
+		if (nac == 0) return;
+		// lambda = (R'*R)\(w + W*h)
+		for (int_t j = 0; j < nac; ++j) lambda[j] = w[j] + dot_nz(&W[j*NZ], h);
+		// forward substitution with R'
+		for (int_t i = 0; i < nac; ++i){
+			const int_t k = (i*i+i)/2;
+			for (int_t j = 0; j < i; ++j) lambda[i] -= R[k+j]*lambda[j];
+			lambda[i] /= R[k+i];
+		}
+		substituteR(lambda);
+	}
+
+	void calc_z(){
+		// z = LiTLi*(W'*lambda) - h
+		for (int_t i = 0; i < NZ; ++i) tmp[i] = 0.0;
+		for (int_t j = 0; j < nac; ++j){
+			for (int_t i = 0; i < NZ; ++i) tmp[i] += W[j*NZ+i]*lambda[j];
+		}
+		mult_LiTLi(tmp, z);
+		for (int_t i = 0; i < NZ; ++i) z[i] -= h[i];
+	}
+
+	void calcInput(){
+		// u = eta2u*(C_u*x0 + Z_u*z)
+		real_t ux[M], uz[M];
+		mult_Kx(x, ux);
+		mult_Kz(z, uz);
+		for (int_t i = 0; i < M; ++i) u[i] = ux[i] + uz[i];
+	}
+
+	// vec = R\vec
+	void substituteR(real_t *const vec) const{
+		for (int_t i = nac-1; i >= 0; --i){
+			for (int_t j = nac-1; j > i; --j) vec[i] -= R[(j*j+j)/2+i]*vec[j];
+			vec[i] /= R[(i*i+3*i)/2];
+		}
+	}
+
+	// d = QT*Li*a
+	void direction(const int_t idx){
+		const int_t i = (idx > 0)?idx-1:-idx-1;
+		real_t a[NZ];
+		for (int_t k = 0; k < NZ; ++k) a[k] = (idx > 0)?AiZ[i*NZ+k]:-AiZ[i*NZ+k];
+		mult_Li(a, tmp);
+		for (int_t k = 0; k < NZ; ++k){
+			d[k] = 0.0;
+			for (int_t l = 0; l < NZ; ++l) d[k] += Q[l*NZ+k]*tmp[l];
+		}
+	}
+
+	// step_z = LiT*Q2*d2
+	void nullspaceStep(){
+		for (int_t l = 0; l < NZ; ++l){
+			tmp[l] = 0.0;
+			for (int_t k = nac; k < NZ; ++k) tmp[l] += Q[l*NZ+k]*d[k];
+		}
+		mult_LiT(tmp, step_z);
+	}
+
+	static void givens(const real_t x, const real_t y, real_t &c, real_t &s){
+		if (x == 0.0){
+			c = 0.0;
+			s = 1.0;
+		}else{
+			const real_t absx = (x >= 0)?x:-x;
+			const real_t nrm = std::sqrt(x*x+y*y);
+			c = absx/nrm;
+			s = x/absx*y/nrm;
+		}
+	}
+
+	// rotate columns c1 and c2 of Q
+	void rotateQ(const int_t c1, const int_t c2, const real_t c, const real_t s){
+		for (int_t l = 0; l < NZ; ++l){
+			const real_t q1 = Q[l*NZ+c1];
+			Q[l*NZ+c1] = c*q1 + s*Q[l*NZ+c2];
+			Q[l*NZ+c2] = -s*q1 + c*Q[l*NZ+c2];
+		}
+	}
+
+	// add constraint idx, d must contain its direction
+	void addConstraint(const int_t idx){
+		const int_t i = (idx > 0)?idx-1:-idx-1;
+		for (int_t k = 0; k < NZ; ++k) W[nac*NZ+k] = (idx > 0)?AiZ[i*NZ+k]:-AiZ[i*NZ+k];
+		w[nac] = bound(idx);
+
+		for (int_t k = NZ-2; k >= nac; --k){
+			real_t c, s;
+			givens(d[k], d[k+1], c, s);
+			rotateQ(k, k+1, c, s);
+			d[k] = c*d[k] + s*d[k+1];
+			d[k+1] = 0.0;
+		}
+		for (int_t k = 0; k <= nac; ++k) R[(nac*nac+nac)/2+k] = d[k];
+		active[nac] = idx;
+		++nac;
+	}
+
+	// remove the constraint at position idx of the active set
+	void removeConstraint(const int_t idx){
+		for (int_t i = idx+1; i < nac; ++i){
+			const int_t i1 = (i*i + 3*i)/2;
+			real_t c, s;
+			givens(R[i1-1], R[i1], c, s);
+			rotateQ(i-1, i, c, s);
+			for (int_t j = i; j < nac; ++j){
+				const int_t k = (j*j + j)/2;
+				const real_t r1 = R[k+i-1];
+				R[k+i-1] = c*r1 + s*R[k+i];
+				R[k+i] = -s*r1 + c*R[k+i];
+			}
+		}
+		for (int_t j = idx; j < nac-1; ++j){
+			const int_t k = (j*j + j)/2;
+			for (int_t i = 0; i < j+1; ++i) R[k+i] = R[k+j+1+i];
+			for (int_t k2 = 0; k2 < NZ; ++k2) W[j*NZ+k2] = W[(j+1)*NZ+k2];
+			w[j] = w[j+1];
+			active[j] = active[j+1];
+		}
+		--nac;
+		if (nac == 0) resetActiveSet();
+	}
+)PMPC";
+
+// dense constraint check with fused bound evaluation
+const char *denseCheckTemplate = R"PMPC(
+	void checkConstraints(){
+		viol_idx = 0;
+		real_t max_error = -INF_BOUND;
+		for (int_t i = 0; i < NC; ++i){
+			const real_t prod = dot_nz(&AiZ[i*NZ], z) + dot_n(&AiC[i*N], x);
+			real_t e1 = prod - UBINEQ_C[i];
+			if (e1 > max_error){
+				viol_idx = i+1;
+				max_error = e1;
+			}
+			e1 = LBINEQ_C[i] - prod;
+			if (e1 > max_error){
+				viol_idx = -i-1;
+				max_error = e1;
+			}
+		}
+		viol = (max_error > TOL);
+	}
+};
+)PMPC";
+
+// skip constraint check (MPCSolver::checkConstraints_skip) on the original constraint numbering
+const char *skipCheckTemplate = R"PMPC(
+	void checkConstraints(){
+		real_t eta_w[NW], norm_w[NP], est_lbErr[NP], est_ubErr[NP], val;
+
+		// eta_w = C0*x0 + C1*z
+		for (int_t i = 0; i < NW; ++i) eta_w[i] = dot_n(&C0[i*N], x) + dot_nz(&C1[i*NZ], z);
+		for (int_t k = 0; k < NP; ++k){
+			real_t nrm = 0.0;
+			for (int_t j = 0; j < S; ++j) nrm += eta_w[k*S+j]*eta_w[k*S+j];
+			norm_w[k] = std::sqrt(nrm);
+		}
+
+		int_t idx1 = 0;
+		real_t max_error = -INF_BOUND;
+		viol_idx = 0;
+
+		// state constraints at t=0 are not in the inequality matrix
+		for (int_t k = 0; k < NP - M; ++k){
+			est_ubErr[k] = INF_BOUND;
+			est_lbErr[k] = INF_BOUND;
+		}
+
+		// input constraints at t=0
+		for (int_t k = NP - M; k < NP; ++k){
+			++idx1;
+			val = dot_s(TAUK, &eta_w[k*S]);
+			est_ubErr[k] = val - B_U[k];
+			est_lbErr[k] = B_L[k] - val;
+			const int_t row = ROW_OF[idx1-1];
+			if (row < 0) continue;
+			if (est_ubErr[k] > max_error){
+				max_error = est_ubErr[k];
+				viol_idx = row+1;
+			}
+			if (est_lbErr[k] > max_error){
+				max_error = est_lbErr[k];
+				viol_idx = -row-1;
+			}
+		}
+
+		// skip constraints loop
+		for (int_t i = 0; i < TSTAR; ++i){
+			for (int_t k = 0; k < NP; ++k){
+				if (TIME_INDICES[(i+1)*NP+k] > 0){
+					++idx1;
+					est_ubErr[k] += NORMS[i]*norm_w[k];
+					est_lbErr[k] += NORMS[i]*norm_w[k];
+
+					if (est_ubErr[k] > max_error || est_lbErr[k] > max_error){
+						val = dot_s(&TAUK[(i+1)*S], &eta_w[k*S]);
+						est_ubErr[k] = val - B_U[k];
+						est_lbErr[k] = B_L[k] - val;
+						const int_t row = ROW_OF[idx1-1];
+						if (row < 0) continue;
+						if (est_ubErr[k] > max_error){
+							max_error = est_ubErr[k];
+							viol_idx = row+1;
+						}
+						if (est_lbErr[k] > max_error){
+							max_error = est_lbErr[k];
+							viol_idx = -row-1;
+						}
+					}
+				}
+			}
+		}
+		viol = (max_error > TOL);
+	}
+};
+)PMPC";
+
+}
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		printf("usage: %s <problem directory> <output header> [namespace]\n",argv[0]);
+		return 1;
+	}
+	std::string dir = argv[1];
+	std::string ns = (argc > 3)?argv[3]:"pMPC_gen";
+	ProblemFiles P;
+
+	// Load basic parameters
+	std::vector<real_t> params;
+	if (!load(dir,"params",params) || params.size() < 8){
+		printf("unable to read parameters from %s\n",dir.c_str());
+		return 1;
+	}
+	P.tolMin = params[0];
+	P.tolMax = params[1];
+	P.maxIter = (int_t)params[2];
+	P.nz = (int_t)params[3];
+	P.nc = (int_t)params[4];
+	P.n = (int_t)params[5];
+	P.m = (int_t)params[6];
+	P.s = (int_t)params[7];
+
+	// Load problem data
+	bool ok = load(dir,"Li",P.Li) && load(dir,"F",P.F) && load(dir,"AiZ",P.AiZ) && load(dir,"AiC",P.AiC) &&
+		load(dir,"lbineq",P.lbineq) && load(dir,"ubineq",P.ubineq) && load(dir,"C",P.C) &&
+		load(dir,"Z",P.Z) && load(dir,"eta2u",P.eta2u) && load(dir,"b_l",P.b_l) && load(dir,"b_u",P.b_u);
+	if (!ok){
+		return 1;
+	}
+	P.np = (int_t)P.b_l.size();
+
+	// same choice of the constraint check as MPCSolver
+	const bool skip = (P.s <= P.nz);
+	if (skip){
+		if (!load(dir,"C0",P.C0) || !load(dir,"C1",P.C1) || !load(dir,"tauk",P.tauk) ||
+			!load(dir,"norms",P.norms) || !load(dir,"time_indices",P.time_indices)){
+			return 1;
+		}
+		// number of future time steps which can be checked with the available data
+		P.t_star = (int_t)P.tauk.size()/P.s - 1;
+		P.t_star = std::min(P.t_star,(int_t)P.time_indices.size()/P.np - 1);
+		P.t_star = std::min(P.t_star,(int_t)P.norms.size());
+	}
+
+	// remove constraints with infinite bounds and merge duplicate constraints
+	std::vector<int_t> order(P.nc);
+	for (int_t i=0; i<P.nc; ++i){
+		order[i] = i;
+	}
+	RowLess less = {&P};
+	std::sort(order.begin(),order.end(),less);
+
+	std::vector<int_t> keep(P.nc,1);
+	std::vector<real_t> lb(P.lbineq), ub(P.ubineq);
+	// the skip check evaluates each original constraint separately, so duplicates are only merged for the dense check
+	for (int_t i=0; i<P.nc && !skip; ){
+		// order is sorted by row and then by index: keep the first row of each group
+		int_t first = order[i], j = i+1;
+		for (; j<P.nc && less.equal(first,order[j]); ++j){
+			lb[first] = std::max(lb[first],lb[order[j]]);
+			ub[first] = std::min(ub[first],ub[order[j]]);
+			keep[order[j]] = 0;
+		}
+		i = j;
+	}
+	for (int_t i=0; i<P.nc; ++i){
+		if (lb[i] <= -INFVAL && ub[i] >= INFVAL){
+			keep[i] = 0;
+		}
+	}
+
+	std::vector<int_t> row_of(P.nc,-1), row_index;
+	std::vector<real_t> AiZ, AiC, lbineq_c, ubineq_c;
+	for (int_t i=0; i<P.nc; ++i){
+		if (!keep[i]){
+			continue;
+		}
+		row_of[i] = (int_t)row_index.size();
+		row_index.push_back(i+1);
+		AiZ.insert(AiZ.end(),&P.AiZ[i*P.nz],&P.AiZ[i*P.nz]+P.nz);
+		AiC.insert(AiC.end(),&P.AiC[i*P.n],&P.AiC[i*P.n]+P.n);
+		lbineq_c.push_back(lb[i]);
+		ubineq_c.push_back(ub[i]);
+	}
+	const int_t nc = (int_t)row_index.size();
+
+	// LiTLi, LF = LiTLi*F and the maps from x0 and z to u
+	std::vector<real_t> LiT(P.nz*P.nz), LiTLi(P.nz*P.nz), LF(P.nz*P.n), Kx(P.m*P.n), Kz(P.m*P.nz);
+	Utils::MatrixTranspose(&P.Li[0],&LiT[0],P.nz,P.nz);
+	Utils::MatrixMult(&LiT[0],&P.Li[0],&LiTLi[0],P.nz,P.nz,P.nz);
+	Utils::MatrixMult(&LiTLi[0],&P.F[0],&LF[0],P.nz,P.nz,P.n);
+	Utils::MatrixMult(&P.eta2u[0],&P.C[P.n*P.s*P.n],&Kx[0],P.m,P.m*P.s,P.n);
+	Utils::MatrixMult(&P.eta2u[0],&P.Z[P.n*P.s*P.nz],&Kz[0],P.m,P.m*P.s,P.nz);
+
+	FILE *file = fopen(argv[2],"w");
+	if (file == 0){
+		printf("unable to write file %s\n",argv[2]);
+		return 1;
+	}
+
+	fprintf(file,"#pragma once\n");
+	fprintf(file,"/// Generated by pMPC_codegen from %s. Do not edit.\n",dir.c_str());
+	fprintf(file,"#include <cmath>\n\nnamespace %s{\n\n",ns.c_str());
+	fprintf(file,"typedef double real_t;\ntypedef int int_t;\n\n");
+	fprintf(file,"constexpr int_t N = %d;\t\t// number of states\n",P.n);
+	fprintf(file,"constexpr int_t M = %d;\t\t// number of inputs\n",P.m);
+	fprintf(file,"constexpr int_t S = %d;\t\t// number of basis functions\n",P.s);
+	fprintf(file,"constexpr int_t NZ = %d;\t\t// number of decision variables\n",P.nz);
+	fprintf(file,"constexpr int_t NC = %d;\t\t// number of inequality constraints (%d before pruning)\n",nc,P.nc);
+	fprintf(file,"constexpr int_t MAXITER = %d;\n",P.maxIter);
+	fprintf(file,"constexpr int_t ITER_RELAX = %d;\n",P.maxIter/2);
+	fprintf(file,"constexpr real_t TOL_MIN = %.17g;\n",P.tolMin);
+	fprintf(file,"constexpr real_t TOL_MAX = %.17g;\n",P.tolMax);
+	fprintf(file,"constexpr real_t INF_BOUND = %.17g;\n",(real_t)INFVAL);
+	fprintf(file,"constexpr real_t EPS_RATIO = %.17g;\n\n",(real_t)EPSVAL);
+
+	writeArray(file,"AiZ",AiZ,"NC*NZ");
+	writeArray(file,"AiC",AiC,"NC*N");
+	writeArray(file,"LBINEQ_C",lbineq_c,"NC");
+	writeArray(file,"UBINEQ_C",ubineq_c,"NC");
+	fprintf(file,"/// original (1 based) index of each constraint\n");
+	writeArray(file,"ROW_INDEX",row_index,"NC");
+
+	if (skip){
+		fprintf(file,"constexpr int_t NP = %d;\t\t// number of constraints at each time step\n",P.np);
+		fprintf(file,"constexpr int_t NW = %d;\n",P.np*P.s);
+		fprintf(file,"constexpr int_t TSTAR = %d;\n\n",P.t_star);
+		writeArray(file,"C0",P.C0,"NW*N");
+		writeArray(file,"C1",P.C1,"NW*NZ");
+		std::vector<real_t> tauk(P.tauk.begin(),P.tauk.begin()+(P.t_star+1)*P.s);
+		writeArray(file,"TAUK",tauk,"(TSTAR+1)*S");
+		std::vector<real_t> norms(P.norms.begin(),P.norms.begin()+P.t_star);
+		writeArray(file,"NORMS",norms,"TSTAR");
+		std::vector<int_t> time_indices(P.time_indices.begin(),P.time_indices.begin()+(P.t_star+1)*P.np);
+		writeArray(file,"TIME_INDICES",time_indices,"(TSTAR+1)*NP");
+		writeArray(file,"B_L",P.b_l,"NP");
+		writeArray(file,"B_U",P.b_u,"NP");
+		fprintf(file,"constexpr int_t NC_ORIG = %d;\n\n",P.nc);
+		fprintf(file,"/// row of each original constraint after pruning, -1 if removed\n");
+		writeArray(file,"ROW_OF",row_of,"NC_ORIG");
+	}
+
+	writeDot(file,"dot_nz",P.nz);
+	writeDot(file,"dot_n",P.n);
+	if (skip){
+		writeDot(file,"dot_s",P.s);
+	}
+	writeMatVec(file,"mult_Li",P.Li,P.nz,P.nz,false);
+	writeMatVec(file,"mult_LiT",P.Li,P.nz,P.nz,true);
+	writeMatVec(file,"mult_LiTLi",LiTLi,P.nz,P.nz,false);
+	writeMatVec(file,"mult_LF",LF,P.nz,P.n,false);
+	writeMatVec(file,"mult_Kx",Kx,P.m,P.n,false);
+	writeMatVec(file,"mult_Kz",Kz,P.m,P.nz,false);
+
+	fprintf(file,"%s",solverTemplate);
+	fprintf(file,"%s",skip?skipCheckTemplate:denseCheckTemplate);
+	fprintf(file,"\n}\n");
+	fclose(file);
+
+	printf("Generated %s: nz = %d, nc = %d (%d removed), %s constraint check.\n",argv[2],P.nz,nc,P.nc-nc,skip?"skip":"dense");
+	return 0;
+}
@@ -0,0 +1,227 @@
+#include "Daemon/SolverServer.h"
+#include "Daemon/SolverClient.h"
+#include "MPCSolver.h"
+#include "DefineSettings.h"
+#include "Utils.h"
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+
+/*
+ * Local solver daemon for many controllers on one host (see SolverServer and DaemonProtocol.h).
+ *
+ * serve: the problems are loaded once and their handles are the order on the command line. The daemon
+ * runs until SIGINT or SIGTERM and then prints the number of requests, states and batches.
+ *
+ * bench: concurrent closed loop simulations with the matrices A and B of the problem directory, one
+ * connection per client. Client c starts from the state x0 = value*(1-c/(2*clients)) in each component.
+ * The same simulations are then run in this process with one MPCSolver per client thread and no daemon,
+ * the baseline of solving in each controller. The throughput and the latency quantiles of both are
+ * reported side by side (round trips for the daemon, solves for the baseline). The inputs of client 0
+ * must be the same bit for bit.
+ *
+ * When to use the daemon: a round trip adds the socket transfer and two thread wake-ups (tens of
+ * microseconds), and the daemon batches requests but does not solve them faster. For problems
+ * which solve in a few microseconds the baseline has the higher throughput and the lower latency at any
+ * number of clients. The daemon pays off when the memory matters, since many controller processes share
+ * one copy of the problem data, or when a solve takes long compared to the round trip. Run bench with the
+ * problem and the number of controllers of the application to see the tradeoff.
+ *
+ * Usage: pMPC_daemon serve <socket> <number of workers> <problem directory>...
+ *        pMPC_daemon bench <socket> <handle> <problem directory> [clients] [steps] [x0 value]
+ * The exit code of bench is 2 if the inputs of client 0 differ.
+ */
+
+namespace {
+	/// latency at quantile q of the sorted latencies
+	double quantile(const std::vector<double> &t, const double q){
+		const size_t i = (size_t)std::ceil(q*t.size());
+		return t[std::min(t.size()-1, (i > 0)?i-1:0)];
+	}
+
+	/// throughput and latencies of a set of closed loop simulations
+	struct Run{
+		double	solves;						///< solves per second
+		std::vector<double>	sorted;			///< latencies of all clients [us], sorted
+	};
+
+	/*!
+	 * concurrent closed loop simulations x(k+1) = A*x(k)+B*u(k), one thread per client, solve(c, x, u)
+	 * computes the inputs of client c and returns false if it fails. The inputs of client 0 are
+	 * written to u0, returns false if a solve failed.
+	 */
+	template<class Solve>
+	bool simulate(const Solve &solve, const int_t nclients, const int_t nsteps, const real_t value,
+		const real_t *const A, const real_t *const B, const int_t n, const int_t m, std::vector<real_t> &u0,
+		Run &run){
+		std::vector<std::vector<double> > latency(nclients, std::vector<double>(nsteps));
+		std::vector<char> failed(nclients, 0);
+		std::vector<std::thread> threads;
+		u0.resize(nsteps*m);
+		const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (int_t c = 0; c < nclients; ++c){
+			threads.push_back(std::thread([&, c]{
+				std::vector<real_t> x(n, value*(1.0-0.5*c/nclients)), u(m), Ax(n), Bu(n);
+				for (int_t step = 0; step < nsteps; ++step){
+					const std::chrono::steady_clock::time_point ts = std::chrono::steady_clock::now();
+					if (!solve(c, &x[0], &u[0])){
+						failed[c] = 1;
+						return;
+					}
+					const std::chrono::steady_clock::time_point te = std::chrono::steady_clock::now();
+					latency[c][step] = std::chrono::duration<double,std::micro>(te-ts).count();
+					if (c == 0){
+						Utils::VectorCopy(&u[0], &u0[step*m], m);
+					}
+					Utils::MatrixMult(A,&x[0],&Ax[0],n,n,1);
+					Utils::MatrixMult(B,&u[0],&Bu[0],n,m,1);
+					Utils::VectorAdd(&Ax[0],&Bu[0],&x[0],n);
+				}
+			}));
+		}
+		for (int_t c = 0; c < nclients; ++c){
+			threads[c].join();
+		}
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+		for (int_t c = 0; c < nclients; ++c){
+			if (failed[c]){
+				printf("client %d lost the connection\n",c);
+				return false;
+			}
+		}
+
+		run.sorted.clear();
+		for (int_t c = 0; c < nclients; ++c){
+			run.sorted.insert(run.sorted.end(), latency[c].begin(), latency[c].end());
+		}
+		std::sort(run.sorted.begin(), run.sorted.end());
+		run.solves = run.sorted.size()/elapsed;
+		return true;
+	}
+
+	/// one line of the bench results
+	void printRun(const char *name, const Run &run){
+		printf("%-12s %10.0f %9.3f %9.3f %9.3f %9.3f\n",name,run.solves,quantile(run.sorted, 0.5),
+			quantile(run.sorted, 0.9),quantile(run.sorted, 0.99),run.sorted.back());
+	}
+
+	int serve(int argc, char **argv){
+		// SIGINT and SIGTERM are taken by sigwait, the threads inherit the mask
+		sigset_t signals;
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGINT);
+		sigaddset(&signals, SIGTERM);
+		pthread_sigmask(SIG_BLOCK, &signals, 0);
+		signal(SIGPIPE, SIG_IGN);
+
+		SolverServer server(atoi(argv[3]));
+		for (int i = 4; i < argc; ++i){
+			const int_t handle = server.addProblem(argv[i]);
+			if (handle < 0){
+				return 1;
+			}
+			printf("problem %d: %s\n",handle,argv[i]);
+		}
+		if (!server.start(argv[2])){
+			return 1;
+		}
+		printf("listening on %s\n",argv[2]);
+		fflush(stdout);
+
+		int sig;
+		sigwait(&signals, &sig);
+		server.stop();
+		const long nbatches = server.getNumberOfBatches();
+		printf("%ld requests, %ld states, %ld batches (%.2f requests per batch)\n",server.getNumberOfRequests(),
+			server.getNumberOfStates(),nbatches,(nbatches > 0)?(double)server.getNumberOfRequests()/nbatches:0.0);
+		return 0;
+	}
+
+	int bench(int argc, char **argv){
+		const std::string path = argv[2], dir = argv[4];
+		const int_t handle = atoi(argv[3]);
+		const int_t nclients = (argc > 5)?atoi(argv[5]):4;
+		const int_t nsteps = (argc > 6)?atoi(argv[6]):1000;
+		const real_t value = (argc > 7)?atof(argv[7]):0.3;
+		if (nclients < 1 || nsteps < 1){
+			printf("the number of clients and steps must be positive\n");
+			return 1;
+		}
+
+		real_t *A,*B;
+		int_t n,m,temp;
+		Utils::LoadVec((dir+"/A").c_str(),&A,temp);
+		n = (int_t)std::sqrt((double)temp);
+		Utils::LoadVec((dir+"/B").c_str(),&B,temp);
+		m = temp/n;
+
+		std::vector<SolverClient> clients(nclients);
+		for (int_t c = 0; c < nclients; ++c){
+			int_t nd, md;
+			if (!clients[c].connect(path)){
+				printf("unable to connect to %s\n",path.c_str());
+				return 1;
+			}
+			if (!clients[c].getDimensions(handle, nd, md) || nd != n || md != m){
+				printf("problem %d of the daemon does not match %s\n",handle,dir.c_str());
+				return 1;
+			}
+		}
+
+		// the daemon, then one solver per client in this process
+		std::vector<real_t> u0, u0_local;
+		Run daemon, local;
+		if (!simulate([&](const int_t c, const real_t *const x, real_t *const u){
+				return clients[c].solve(handle, x, u);
+			}, nclients, nsteps, value, A, B, n, m, u0, daemon)){
+			delete[] A;
+			delete[] B;
+			return 1;
+		}
+		std::vector<MPCSolver*> solvers(nclients);
+		for (int_t c = 0; c < nclients; ++c){
+			solvers[c] = new MPCSolver(dir);
+		}
+		simulate([&](const int_t c, const real_t *const x, real_t *const u){
+				solvers[c]->solve(x);
+				solvers[c]->getControlInputs(u);
+				return true;
+			}, nclients, nsteps, value, A, B, n, m, u0_local, local);
+		for (int_t c = 0; c < nclients; ++c){
+			delete solvers[c];
+		}
+		delete[] A;
+		delete[] B;
+
+		int_t mismatches = 0;
+		for (int_t step = 0; step < nsteps; ++step){
+			mismatches += (memcmp(&u0_local[step*m], &u0[step*m], m*sizeof(real_t)) != 0)?1:0;
+		}
+		printf("%d clients x %d steps\n",nclients,nsteps);
+		printf("%-12s %10s %9s %9s %9s %9s\n","","solves/s","p50 [us]","p90 [us]","p99 [us]","max [us]");
+		printRun("daemon", daemon);
+		printRun("in-process", local);
+		printf("client 0 of the daemon against the in-process solver: %d of %d inputs differ\n",mismatches,nsteps);
+		return (mismatches > 0)?2:0;
+	}
+}
+
+int main(int argc, char **argv){
+	if (argc >= 5 && strcmp(argv[1], "serve") == 0){
+		return serve(argc, argv);
+	}
+	if (argc >= 5 && strcmp(argv[1], "bench") == 0){
+		return bench(argc, argv);
+	}
+	printf("usage: %s serve <socket> <number of workers> <problem directory>...\n"
+		"       %s bench <socket> <handle> <problem directory> [clients] [steps] [x0 value]\n",argv[0],argv[0]);
+	return 1;
+}
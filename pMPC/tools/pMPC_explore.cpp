@@ -0,0 +1,231 @@
+#include "ProblemBuilder.h"
+#include "MPCSolver.h"
+#include "DefineSettings.h"
+#include "Utils.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+/*
+ * Design space exploration of the basis functions and the MOAS of a parameterized MPC problem.
+ *
+ * Every combination of the number of basis functions s, the decay constant alpha (the pole of the
+ * Laguerre functions) and maxSize of the MOAS is built from the specification directory (see
+ * ProblemSpec::load) as pMPC_build does, and written to a subdirectory of the output directory. A
+ * closed loop simulation from x0 of the specification is run with MPCSolver on each problem. The
+ * results are printed side by side and written to explore.csv in the output directory: the status
+ * ("ok", or "build failed" for a configuration rejected by the builder, with empty results), the size
+ * of the QP, the build time, the memory of the problem data (ProblemData::getMemorySize), the latency
+ * quantiles of the solves, the closed loop cost sum x'*Q*x + u'*R*u and the number of solves with a
+ * nonzero exit flag.
+ *
+ * Usage: pMPC_explore <specification directory> <output directory> <s values> <alpha values>
+ *	[maxSize values] [number of steps] [number of threads]
+ * The values are separated by commas, e.g. 4,6,8. maxSize 0 keeps the constraint time steps of the
+ * specification (time_indices or horizon), the default is the moas file of the specification.
+ * The threads are used by the builder.
+ */
+
+namespace {
+	/// parse a list of numbers separated by commas
+	std::vector<real_t> parseList(const char *str){
+		std::vector<real_t> values;
+		const char *pos = str;
+		while (*pos){
+			char *end;
+			values.push_back(strtod(pos, &end));
+			if (end == pos){
+				return std::vector<real_t>();
+			}
+			pos = (*end == ',')?end+1:end;
+		}
+		return values;
+	}
+
+	void makeDirectory(const std::string &dir){
+#ifdef _WIN32
+		_mkdir(dir.c_str());
+#else
+		mkdir(dir.c_str(), 0755);
+#endif
+	}
+
+	/// latency at quantile q of the sorted latencies
+	double quantile(const std::vector<double> &t, const double q){
+		const size_t i = (size_t)std::ceil(q*t.size());
+		return t[std::min(t.size()-1, (i > 0)?i-1:0)];
+	}
+
+	/// results of one configuration
+	struct Result{
+		int_t	s,
+				maxSize,
+				nz,
+				nc,
+				t_star,
+				failed;			///< solves with a nonzero exit flag
+		const char	*status;		///< "ok", or why the configuration has no results
+		real_t	alpha,
+				cost;			///< closed loop cost
+		double	buildTime,		///< ms
+				memory,			///< kB
+				mean,			///< latency in us
+				p50,
+				p99,
+				max;
+	};
+}
+
+int main(int argc, char **argv){
+	if (argc < 5){
+		printf("usage: %s <specification directory> <output directory> <s values> <alpha values> "
+			"[maxSize values] [number of steps] [number of threads]\n",argv[0]);
+		return 1;
+	}
+	const std::string dir_out = argv[2];
+	const std::vector<real_t> s_values = parseList(argv[3]), alpha_values = parseList(argv[4]);
+	const int_t nsteps = (argc > 6)?atoi(argv[6]):1000;
+	const int_t nthreads = (argc > 7)?atoi(argv[7]):1;
+
+	ProblemSpec spec;
+	if (!spec.load(argv[1])){
+		return 1;
+	}
+	const std::vector<real_t> size_values = (argc > 5)?parseList(argv[5]):std::vector<real_t>(1, (real_t)spec.maxSize);
+	if (s_values.empty() || alpha_values.empty() || size_values.empty()){
+		printf("the values must be numbers separated by commas\n");
+		return 1;
+	}
+	const int_t n = spec.n, m = spec.m;
+	if (spec.x0.empty()){
+		printf("x0 of the specification is needed for the simulations\n");
+		return 1;
+	}
+	makeDirectory(dir_out);
+
+	std::vector<Result> results;
+	std::vector<real_t> x(n), u(m), Ax(n), Bu(n), Qx(n), Ru(m);
+	std::vector<double> latency(nsteps);
+	for (size_t i = 0; i < s_values.size(); ++i){
+		for (size_t j = 0; j < alpha_values.size(); ++j){
+			for (size_t k = 0; k < size_values.size(); ++k){
+				ProblemSpec config = spec;
+				config.s = (int_t)s_values[i];
+				config.alpha = alpha_values[j];
+				config.maxSize = (int_t)size_values[k];
+				if (config.maxSize > 0){
+					config.time_indices.clear();
+				}
+
+				char name[64];
+				snprintf(name, sizeof(name), "s%d_a%g_m%d", config.s, config.alpha, config.maxSize);
+				const std::string dir = dir_out+"/"+name;
+				printf("%s: ",name);
+				fflush(stdout);
+
+				Result r;
+				r.s = config.s;
+				r.alpha = config.alpha;
+				r.maxSize = config.maxSize;
+				r.status = "ok";
+
+				// configurations which cannot be built stay in the table with their status
+				std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+				ProblemBuilder builder(config, nthreads);
+				if (!builder.build()){
+					r.status = "build failed";
+					results.push_back(r);
+					continue;
+				}
+				std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+				makeDirectory(dir);
+				if (!builder.save(dir)){
+					printf("unable to write %s\n",dir.c_str());
+					r.status = "write failed";
+					results.push_back(r);
+					continue;
+				}
+
+				r.nz = builder.getNumberOfVariables();
+				r.nc = builder.getNumberOfConstraints();
+				r.t_star = builder.getTStar();
+				r.buildTime = std::chrono::duration<double,std::milli>(t1-t0).count();
+				r.cost = 0.0;
+				r.failed = 0;
+
+				// closed loop simulation
+				MPCSolver solver(dir);
+				r.memory = solver.getProblemData()->getMemorySize()/1024.0;
+				Utils::VectorCopy(&spec.x0[0], &x[0], n);
+				for (int_t step = 0; step < nsteps; ++step){
+					std::chrono::steady_clock::time_point ts = std::chrono::steady_clock::now();
+					solver.solve(&x[0]);
+					std::chrono::steady_clock::time_point te = std::chrono::steady_clock::now();
+					latency[step] = std::chrono::duration<double,std::micro>(te-ts).count();
+					r.failed += (solver.getExitFlag() != 0)?1:0;
+					solver.getControlInputs(&u[0]);
+
+					real_t xQx, uRu;
+					Utils::MatrixMult(&spec.Q[0], &x[0], &Qx[0], n, n, 1);
+					Utils::MatrixMult(&spec.R[0], &u[0], &Ru[0], m, m, 1);
+					Utils::DotProduct(&x[0], &Qx[0], n, xQx);
+					Utils::DotProduct(&u[0], &Ru[0], m, uRu);
+					r.cost += xQx+uRu;
+
+					Utils::MatrixMult(&spec.A[0], &x[0], &Ax[0], n, n, 1);
+					Utils::MatrixMult(&spec.B[0], &u[0], &Bu[0], n, m, 1);
+					Utils::VectorAdd(&Ax[0], &Bu[0], &x[0], n);
+				}
+				std::vector<double> sorted(latency);
+				std::sort(sorted.begin(), sorted.end());
+				r.mean = 0.0;
+				for (int_t step = 0; step < nsteps; ++step){
+					r.mean += sorted[step]/nsteps;
+				}
+				r.p50 = quantile(sorted, 0.5);
+				r.p99 = quantile(sorted, 0.99);
+				r.max = sorted.back();
+				results.push_back(r);
+				printf("done\n");
+			}
+		}
+	}
+
+	// table of all configurations
+	FILE *fp = fopen((dir_out+"/explore.csv").c_str(), "w");
+	if (fp){
+		fprintf(fp, "s,alpha,maxSize,status,nz,nc,t_star,build_ms,memory_kB,mean_us,p50_us,p99_us,max_us,cost,failed\n");
+	}
+	printf("\n%4s %8s %7s %4s %6s %6s %10s %10s %9s %9s %9s %9s %14s %6s\n","s","alpha","maxSize","nz","nc",
+		"t_star","build ms","memory kB","mean us","p50 us","p99 us","max us","cost","failed");
+	for (size_t i = 0; i < results.size(); ++i){
+		const Result &r = results[i];
+		if (strcmp(r.status, "ok") != 0){
+			printf("%4d %8g %7d %4s %s\n",r.s,r.alpha,r.maxSize,"",r.status);
+			if (fp){
+				fprintf(fp, "%d,%g,%d,%s,,,,,,,,,,,\n",r.s,r.alpha,r.maxSize,r.status);
+			}
+			continue;
+		}
+		printf("%4d %8g %7d %4d %6d %6d %10.1f %10.1f %9.3f %9.3f %9.3f %9.3f %14.6g %6d\n",r.s,r.alpha,r.maxSize,
+			r.nz,r.nc,r.t_star,r.buildTime,r.memory,r.mean,r.p50,r.p99,r.max,r.cost,r.failed);
+		if (fp){
+			fprintf(fp, "%d,%g,%d,%s,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.16g,%d\n",r.s,r.alpha,r.maxSize,r.status,
+				r.nz,r.nc,r.t_star,r.buildTime,r.memory,r.mean,r.p50,r.p99,r.max,r.cost,r.failed);
+		}
+	}
+	if (!fp || fclose(fp) != 0){
+		printf("unable to write %s/explore.csv\n",dir_out.c_str());
+		return 1;
+	}
+	return 0;
+}
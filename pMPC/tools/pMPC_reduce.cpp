@@ -0,0 +1,92 @@
+#include "ProblemReducer.h"
+#include "DefineSettings.h"
+#include "Utils.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+/*
+ * Offline removal of redundant constraints, the C++ version of Matlab/redundant_cons.m.
+ *
+ * Removes the rows of AiZ which the other rows keep strictly inside their bounds for all initial states
+ * in a box, and sorts the remaining rows by the number of times they were active. The activity is read
+ * from a file with one count per constraint of the original problem (e.g. activity.txt of an earlier
+ * run), or recorded with closed loop simulations from random initial states in the box.
+ * The reduced problem contains row_map with the original index of each row, see QPSolver::getOriginalIndex.
+ *
+ * Usage: pMPC_reduce <problem directory> <reduced directory> <state box> [activity] [number of threads]
+ * The state box is a file in the format of Utils::LoadVec with [xl; xu], the activity "-" is recorded.
+ */
+
+namespace {
+	/// file name without the extension .txt added by Utils::LoadVec
+	std::string baseName(std::string file){
+		if (file.size() > 4 && file.compare(file.size()-4, 4, ".txt") == 0){
+			file.resize(file.size()-4);
+		}
+		return file;
+	}
+}
+
+int main(int argc, char **argv){
+	if (argc < 4){
+		printf("usage: %s <problem directory> <reduced directory> <state box> [activity] [number of threads]\n",argv[0]);
+		return 1;
+	}
+	const std::string dir = argv[1], dir_out = argv[2], box = baseName(argv[3]);
+	const std::string activity = (argc > 4)?argv[4]:"-";
+	const int_t nthreads = (argc > 5)?atoi(argv[5]):1;
+	if (dir == dir_out){
+		printf("the reduced problem must be written to another directory\n");
+		return 1;
+	}
+
+	if (!Utils::FileExists(box.c_str())){
+		printf("unable to read %s.txt\n",box.c_str());
+		return 1;
+	}
+	real_t *bounds;
+	int_t nb;
+	Utils::LoadVec(box.c_str(),&bounds,nb);
+	const std::vector<real_t> xl(bounds, bounds+nb/2), xu(bounds+nb/2, bounds+nb);
+	delete[] bounds;
+
+	ProblemReducer reducer(dir, xl, xu, nthreads);
+	if (!reducer.isValid()){
+		printf("%s is not an MPC problem with AiZ and AiC, or the box does not have 2*n bounds\n",dir.c_str());
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	if (!reducer.removeRedundant()){
+		return 1;
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	if (activity != "-"){
+		if (!reducer.loadActivity(baseName(activity))){
+			return 1;
+		}
+	}else if (!reducer.recordActivity(20, 200)){
+		return 1;
+	}
+
+#ifdef _WIN32
+	_mkdir(dir_out.c_str());
+#else
+	mkdir(dir_out.c_str(), 0755);
+#endif
+	if (!reducer.save(dir_out)){
+		return 1;
+	}
+
+	printf("Reduced %s: %d of %d rows are redundant (%d LP iterations in %.1f ms).\n",dir_out.c_str(),
+		reducer.getNumberOfRedundant(),reducer.getNumberOfRows(),reducer.getIterations(),
+		std::chrono::duration<double,std::milli>(t1-t0).count());
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include "MPCSolver.h"
+#include "StateLog.h"
+#include "DefineSettings.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+ * Replay of a state log recorded with MPCSolver::startRecording. The recorded states are solved in order
+ * by a solver of the problem, starting from the snapshot in the log, with the engine, constraint check
+ * and number of threads given on the command line. If the log contains the outputs, the control inputs
+ * are compared with the recorded ones (bit for bit with tolerance 0) together with the number of
+ * iterations and the exit flag. The latency distribution of the solves is reported.
+ *
+ * Usage: pMPC_replay <problem directory> <log> [tolerance] [primal|dual] [dense|skip] [number of threads]
+ * "-" keeps the default of an option. The exit code is 2 if an output differs from the log.
+ */
+
+namespace {
+	/// latency at quantile q of the sorted latencies
+	double quantile(const std::vector<double> &t, const double q){
+		const size_t i = (size_t)std::ceil(q*t.size());
+		return t[std::min(t.size()-1, (i > 0)?i-1:0)];
+	}
+}
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		printf("usage: %s <problem directory> <log> [tolerance] [primal|dual] [dense|skip] [number of threads]\n",argv[0]);
+		return 1;
+	}
+	const std::string dir = argv[1];
+	const real_t tol = (argc > 3 && strcmp(argv[3], "-"))?atof(argv[3]):0.0;
+
+	StateLog log;
+	if (!log.open(argv[2])){
+		return 1;
+	}
+	MPCSolver solver(dir);
+	const int_t n = log.getNumberOfStates(), m = log.getNumberOfOutputs();
+	if (m != solver.getNumberOfOutputs() || n != solver.getProblemData()->n){
+		printf("the log does not belong to the problem in %s\n",dir.c_str());
+		return 1;
+	}
+
+	if (argc > 4 && strcmp(argv[4], "-")){
+		solver.setEngine(strcmp(argv[4], "dual")?PRIMAL_ENGINE:DUAL_ENGINE);
+	}
+	if (argc > 5 && strcmp(argv[5], "-") && !solver.setCheckStrategy(strcmp(argv[5], "skip")?DENSE_CHECK:SKIP_CHECK)){
+		printf("the constraint check %s is not available for this problem\n",argv[5]);
+		return 1;
+	}
+	if (argc > 6 && strcmp(argv[6], "-")){
+		solver.setNumThreads(atoi(argv[6]));
+	}
+	const std::vector<char> &snapshot = log.getSnapshot();
+	if (!snapshot.empty() && !solver.restoreSnapshot(snapshot.data(), (int_t)snapshot.size())){
+		printf("the replay starts cold\n");
+	}
+
+	std::vector<real_t> x0(n), u(m), u_log(m);
+	std::vector<double> latency;
+	int_t its_log, flag_log, n_diff = 0, n_its = 0, n_flag = 0;
+	real_t max_diff = 0.0;
+	while (log.next(&x0[0], &u_log[0], its_log, flag_log)){
+		auto t0 = std::chrono::steady_clock::now();
+		solver.solve(&x0[0]);
+		auto t1 = std::chrono::steady_clock::now();
+		latency.push_back(std::chrono::duration<double,std::micro>(t1-t0).count());
+
+		if (!log.hasOutputs()){
+			continue;
+		}
+		solver.getControlInputs(&u[0]);
+		bool same = true;
+		for (int_t j = 0; j < m; ++j){
+			const real_t diff = std::fabs(u[j]-u_log[j]);
+			max_diff = std::max(max_diff, diff);
+			same = same && ((tol > 0)?(diff <= tol):(u[j] == u_log[j]));
+		}
+		n_diff += same?0:1;
+		n_its += (solver.getIterNumber() != its_log)?1:0;
+		n_flag += (solver.getExitFlag() != flag_log)?1:0;
+	}
+	if (latency.empty()){
+		printf("the log contains no states\n");
+		return 1;
+	}
+
+	double sum = 0.0;
+	for (size_t i = 0; i < latency.size(); ++i){
+		sum += latency[i];
+	}
+	std::sort(latency.begin(), latency.end());
+	printf("%d states, latency in us: mean %.3f  min %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+		(int_t)latency.size(), sum/latency.size(), latency.front(), quantile(latency, 0.5), quantile(latency, 0.9),
+		quantile(latency, 0.99), quantile(latency, 0.999), latency.back());
+	if (!log.hasOutputs()){
+		printf("the log contains no outputs to compare\n");
+		return 0;
+	}
+	printf("outputs differ in %d states (max |u - u_log| = %g), iterations in %d, exit flags in %d\n",
+		n_diff, max_diff, n_its, n_flag);
+	return (n_diff > 0)?2:0;
+}